@@ -10,6 +10,10 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _clock(&
     identity_store(fs, "/identity")
 #endif
 {
+  memset(blob_used, 0, sizeof(blob_used));
+  memset(blob_dirty, 0, sizeof(blob_dirty));
+  blob_tick = 0;
+  num_journal_recs = 0;
 }
 
 static File openWrite(FILESYSTEM* _fs, const char* filename) {
@@ -23,19 +27,196 @@ static File openWrite(FILESYSTEM* _fs, const char* filename) {
 #endif
 }
 
+static File openUpdate(FILESYSTEM* _fs, const char* filename) {   // for writes at any position
+  if (!_fs->exists(filename)) {
+    File file = openWrite(_fs, filename);
+    if (file) file.close();
+  }
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(filename, "r+");
+#else
+  return _fs->open(filename, "r+", false);
+#endif
+}
+
 void DataStore::begin() {
 #if defined(RP2040_PLATFORM)
   identity_store.begin();
 #endif
 
+  if (_fs->exists("/adv_slots")) {
+    File file = openRead("/adv_slots");
+    uint32_t size = file ? file.size() : 0;
+    if (file) file.close();
+    if (size != ADV_BLOB_SLOTS * sizeof(BlobRec)) {   // ADV_BLOB_SLOTS has changed, so re-hash into new file
+      _fs->rename("/adv_slots", "/adv_slots_old");
+      migrateBlobs("/adv_slots_old");
+    }
+  }
+  checkBlobFile();
+
+#ifdef MAX_COLD_CONTACTS
+  File swap = openWrite(_fs, "/contacts_swap");   // truncate, only valid for this boot
+  if (swap) swap.close();
+#endif
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  checkAdvBlobFile();
-#else
-  // init 'blob store' support
-  _fs->mkdir("/bl");
+  if (_fs->exists("/adv_blobs")) {   // migrate from old (linear scan) blob file
+    migrateBlobs("/adv_blobs");
+  }
 #endif
 }
 
+void DataStore::migrateBlobs(const char* filename) {
+  File file = openRead(filename);
+  if (file) {
+    BlobRec tmp;
+    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
+      if (tmp.len > 0) putBlobByKey(NULL, tmp.key, sizeof(tmp.key), tmp.data, tmp.len);   // NOTE: contacts not loaded yet
+    }
+    file.close();
+    flushBlobs(NULL);
+  }
+  _fs->remove(filename);
+}
+
+#ifdef MAX_COLD_CONTACTS
+/*
+ * Swap file for contacts paged out of RAM (see BaseChatMesh). Raw ContactInfo records at 'slot' index, as the
+ * file is recreated each boot (so no need for a stable format). NOTE: includes the shared_secret.
+ */
+bool DataStore::writeSwapContact(int slot, const ContactInfo& contact) {
+  File file = openUpdate(_fs, "/contacts_swap");
+  if (!file) return false;
+
+  bool success = true;
+  uint32_t pos = slot * sizeof(ContactInfo);
+  if (file.size() < pos) {   // grow file, up to this slot
+    ContactInfo zeroes;
+    memset(&zeroes, 0, sizeof(zeroes));
+    file.seek(file.size());
+    for (uint32_t n = file.size(); success && n < pos; n += sizeof(zeroes)) {
+      success = file.write((uint8_t *) &zeroes, sizeof(zeroes)) == sizeof(zeroes);
+    }
+  }
+  if (success) {
+    file.seek(pos);
+    success = file.write((const uint8_t *) &contact, sizeof(contact)) == sizeof(contact);
+  }
+  file.close();
+  return success;
+}
+
+bool DataStore::readSwapContact(int slot, ContactInfo& contact) {
+  File file = openRead("/contacts_swap");
+  if (!file) return false;
+
+  file.seek(slot * sizeof(ContactInfo));
+  bool success = file.read((uint8_t *) &contact, sizeof(contact)) == sizeof(contact);
+  file.close();
+  return success;
+}
+#endif
+
+/*
+ * Offline frames log (see MyMesh::addToOfflineQueue()). Fixed size OfflineRec slots in '/offline_q', so a record is
+ * (over)written in place, and a torn write only ever damages that one record.
+ */
+static void calcOfflineCheck(const OfflineRec& rec, uint8_t check[]) {
+  const int hdr_len = sizeof(rec.seq) + sizeof(rec.len);
+  mesh::Utils::sha256(check, sizeof(rec.check), (const uint8_t *) &rec, hdr_len, rec.frame, rec.len);
+}
+
+void DataStore::loadOfflineLog(uint32_t& read_seq, uint32_t& write_seq) {
+  read_seq = 0;
+  File pos = openRead("/offline_q_pos");
+  if (pos) {
+    if (pos.read((uint8_t *) &read_seq, sizeof(read_seq)) != sizeof(read_seq)) read_seq = 0;  // torn, replay whole log
+    pos.close();
+  }
+
+  write_seq = read_seq;
+  File file = openRead("/offline_q");
+  if (file) {
+    OfflineRec hdr;
+    const int hdr_len = sizeof(hdr.seq) + sizeof(hdr.len);
+    for (uint32_t slot = 0; file.read((uint8_t *) &hdr, hdr_len) == hdr_len; slot++) {
+      if (hdr.len > 0 && hdr.seq % OFFLINE_LOG_SLOTS == slot && hdr.seq >= write_seq) {
+        write_seq = hdr.seq + 1;
+      }
+      file.seek((slot + 1) * sizeof(OfflineRec));
+    }
+    file.close();
+  }
+  if (write_seq - read_seq > OFFLINE_LOG_SLOTS) {   // read_seq was stale, oldest records have been overwritten
+    read_seq = write_seq - OFFLINE_LOG_SLOTS;
+  }
+}
+
+bool DataStore::writeOfflineFrame(uint32_t seq, const uint8_t frame[], uint8_t len) {
+  if (len == 0 || len > MAX_FRAME_SIZE) return false;
+
+  File file = openUpdate(_fs, "/offline_q");
+  if (!file) return false;
+
+  OfflineRec rec;
+  memset(&rec, 0, sizeof(rec));
+
+  bool success = true;
+  uint32_t pos = (seq % OFFLINE_LOG_SLOTS) * sizeof(rec);
+  if (file.size() < pos) {   // grow file, up to this slot
+    file.seek(file.size());
+    for (uint32_t n = file.size(); success && n < pos; n += sizeof(rec)) {
+      success = file.write((const uint8_t *) &rec, sizeof(rec)) == sizeof(rec);
+    }
+  }
+  if (success) {
+    rec.seq = seq;
+    rec.len = len;
+    memcpy(rec.frame, frame, len);
+    calcOfflineCheck(rec, rec.check);
+
+    file.seek(pos);
+    success = file.write((const uint8_t *) &rec, sizeof(rec)) == sizeof(rec);
+  }
+  file.close();
+  return success;
+}
+
+int DataStore::readOfflineFrame(uint32_t seq, uint8_t frame[]) {
+  File file = openRead("/offline_q");
+  if (!file) return 0;
+
+  OfflineRec rec;
+  file.seek((seq % OFFLINE_LOG_SLOTS) * sizeof(rec));
+  bool success = file.read((uint8_t *) &rec, sizeof(rec)) == sizeof(rec);
+  file.close();
+
+  if (!success || rec.seq != seq || rec.len == 0 || rec.len > MAX_FRAME_SIZE) return 0;
+
+  uint8_t check[sizeof(rec.check)];
+  calcOfflineCheck(rec, check);
+  if (memcmp(check, rec.check, sizeof(check)) != 0) return 0;   // torn write
+
+  memcpy(frame, rec.frame, rec.len);
+  return rec.len;
+}
+
+void DataStore::saveOfflineReadSeq(uint32_t read_seq) {
+  File file = openWrite(_fs, "/offline_q_pos");
+  if (file) {
+    file.write((const uint8_t *) &read_seq, sizeof(read_seq));
+    file.close();
+  }
+}
+
+void DataStore::clearOfflineLog() {
+  _fs->remove("/offline_q");   // NOTE: log first, so a crash in between leaves a valid (empty) log
+  _fs->remove("/offline_q_pos");
+}
+
 #if defined(ESP32)
   #include <SPIFFS.h>
 #elif defined(RP2040_PLATFORM)
@@ -164,7 +345,8 @@ void DataStore::loadPrefsInt(const char *filename, NodePrefs& _prefs, double& no
     file.read((uint8_t *)&_prefs.rx_delay_base, sizeof(_prefs.rx_delay_base));             // 72
     file.read((uint8_t *)&_prefs.advert_loc_policy, sizeof(_prefs.advert_loc_policy));     // 76
     file.read((uint8_t *)&_prefs.multi_acks, sizeof(_prefs.multi_acks));                   // 77
-    file.read(pad, 2);                                                                     // 78
+    file.read((uint8_t *)&_prefs.text_compression, sizeof(_prefs.text_compression));       // 78
+    file.read(pad, 1);                                                                     // 79
     file.read((uint8_t *)&_prefs.ble_pin, sizeof(_prefs.ble_pin));                         // 80
 
     file.close();
@@ -195,13 +377,57 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
     file.write((uint8_t *)&_prefs.rx_delay_base, sizeof(_prefs.rx_delay_base));             // 72
     file.write((uint8_t *)&_prefs.advert_loc_policy, sizeof(_prefs.advert_loc_policy));     // 76
     file.write((uint8_t *)&_prefs.multi_acks, sizeof(_prefs.multi_acks));                   // 77
-    file.write(pad, 2);                                                                     // 78
+    file.write((uint8_t *)&_prefs.text_compression, sizeof(_prefs.text_compression));       // 78
+    file.write(pad, 1);                                                                     // 79
     file.write((uint8_t *)&_prefs.ble_pin, sizeof(_prefs.ble_pin));                         // 80
 
     file.close();
   }
 }
 
+#define JOURNAL_OP_UPSERT   1    // followed by contact record
+#define JOURNAL_OP_DELETE   2    // followed by pub_key
+
+static bool readContactRec(File& file, ContactInfo& c) {
+  uint8_t pub_key[32];
+
+  bool success = (file.read(pub_key, 32) == 32);
+  success = success && (file.read((uint8_t *)&c.name, 32) == 32);
+  success = success && (file.read(&c.type, 1) == 1);
+  success = success && (file.read(&c.flags, 1) == 1);
+  success = success && (file.read(&c.out_path_ver, 1) == 1);   // was 'unused'
+  success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
+  success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
+  success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
+  success = success && (file.read(c.out_path, 64) == 64);
+  success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
+  success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
+  success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+
+  if (success) {
+    c.id = mesh::Identity(pub_key);
+    c.payload_ver = PAYLOAD_VER_1;   // until we hear their next advert
+    c.adv_feat1 = 0;
+  }
+  return success;
+}
+
+static bool writeContactRec(File& file, const ContactInfo& c) {
+  bool success = (file.write(c.id.pub_key, 32) == 32);
+  success = success && (file.write((uint8_t *)&c.name, 32) == 32);
+  success = success && (file.write(&c.type, 1) == 1);
+  success = success && (file.write(&c.flags, 1) == 1);
+  success = success && (file.write(&c.out_path_ver, 1) == 1);
+  success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
+  success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
+  success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
+  success = success && (file.write(c.out_path, 64) == 64);
+  success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
+  success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
+  success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
+  return success;
+}
+
 void DataStore::loadContacts(DataStoreHost* host) {
   if (_fs->exists("/contacts3")) {
 #if defined(RP2040_PLATFORM)
@@ -213,30 +439,46 @@ void DataStore::loadContacts(DataStoreHost* host) {
       bool full = false;
       while (!full) {
         ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
+        if (!readContactRec(file, c)) break; // EOF
 
-        if (!success) break; // EOF
-
-        c.id = mesh::Identity(pub_key);
         if (!host->onContactLoaded(c)) full = true;
       }
       file.close();
     }
   }
+
+  // now replay changes since
+  num_journal_recs = 0;
+  if (_fs->exists("/contacts_jnl")) {
+#if defined(RP2040_PLATFORM)
+    File file = _fs->open("/contacts_jnl", "r");
+#else
+    File file = _fs->open("/contacts_jnl");
+#endif
+    if (file) {
+      bool torn = false;
+      uint8_t op;
+      while (file.read(&op, 1) == 1) {
+        if (op == JOURNAL_OP_UPSERT) {
+          ContactInfo c;
+          if (!readContactRec(file, c)) { torn = true; break; }  // partial record (ie. power lost while appending)
+          host->onContactLoaded(c);
+        } else if (op == JOURNAL_OP_DELETE) {
+          uint8_t pub_key[PUB_KEY_SIZE];
+          if (file.read(pub_key, PUB_KEY_SIZE) != PUB_KEY_SIZE) { torn = true; break; }
+          host->onContactDeleted(pub_key);
+        } else {
+          MESH_DEBUG_PRINTLN("DataStore::loadContacts() - corrupt journal");
+          torn = true;
+          break;
+        }
+        num_journal_recs++;
+      }
+      file.close();
+
+      if (torn) saveContacts(host);   // compact now, so new records aren't appended after the bad one
+    }
+  }
 }
 
 void DataStore::saveContacts(DataStoreHost* host) {
@@ -244,30 +486,55 @@ void DataStore::saveContacts(DataStoreHost* host) {
   if (file) {
     uint32_t idx = 0;
     ContactInfo c;
-    uint8_t unused = 0;
 
+    bool success = true;
     while (host->getContactForSave(idx, c)) {
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
-
+      success = writeContactRec(file, c);
       if (!success) break; // write failed
 
       idx++;  // advance to next contact
     }
     file.close();
+
+    if (success) {   // journal is now redundant
+      _fs->remove("/contacts_jnl");
+      num_journal_recs = 0;
+    }
   }
 }
 
+void DataStore::saveContactChanges(DataStoreHost* host, const uint8_t pub_keys[][PUB_KEY_SIZE], int num) {
+  if (num_journal_recs + num > CONTACTS_JOURNAL_MAX) {
+    saveContacts(host);   // compact
+    return;
+  }
+
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  File file = _fs->open("/contacts_jnl", FILE_O_WRITE);   // NOTE: opens at end of file
+#elif defined(RP2040_PLATFORM)
+  File file = _fs->open("/contacts_jnl", "a");
+#else
+  File file = _fs->open("/contacts_jnl", "a", true);
+#endif
+  if (file) {
+    bool success = true;
+    for (int i = 0; i < num && success; i++) {
+      ContactInfo c;
+      if (host->getContactByKey(pub_keys[i], c)) {
+        uint8_t op = JOURNAL_OP_UPSERT;
+        success = file.write(&op, 1) == 1 && writeContactRec(file, c);
+      } else {
+        uint8_t op = JOURNAL_OP_DELETE;
+        success = file.write(&op, 1) == 1 && file.write(pub_keys[i], PUB_KEY_SIZE) == PUB_KEY_SIZE;
+      }
+      num_journal_recs++;
+    }
+    file.close();
+    if (success) return;
+  }
+  saveContacts(host);   // can't append, so fallback to full rewrite
+}
+
 void DataStore::loadChannels(DataStoreHost* host) {
   if (_fs->exists("/channels2")) {
 #if defined(RP2040_PLATFORM)
@@ -319,24 +586,27 @@ void DataStore::saveChannels(DataStoreHost* host) {
   }
 }
 
+/*
+ * Advert blobs (raw advert packets, for 'share contact') are stored in fixed size slots in one file, addressed by
+ * hash of key, so lookups only read a few records. New blobs are held in a write-back cache, and written in batches.
+ */
+File DataStore::openBlobFile(bool for_write) {
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open("/adv_slots", for_write ? FILE_O_WRITE : FILE_O_READ);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open("/adv_slots", for_write ? "r+" : "r");
+#else
+  return _fs->open("/adv_slots", for_write ? "r+" : "r", false);
+#endif
+}
 
-#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
-
-struct BlobRec {
-  uint32_t timestamp;
-  uint8_t  key[7];
-  uint8_t  len;
-  uint8_t  data[MAX_ADVERT_PKT_LEN];
-};
-
-void DataStore::checkAdvBlobFile() {
-  if (!_fs->exists("/adv_blobs")) {
-    File file = openWrite(_fs, "/adv_blobs");
+void DataStore::checkBlobFile() {
+  if (!_fs->exists("/adv_slots")) {
+    File file = openWrite(_fs, "/adv_slots");
     if (file) {
       BlobRec zeroes;
       memset(&zeroes, 0, sizeof(zeroes));
-      for (int i = 0; i < 20; i++) {     // pre-allocate to fixed size
+      for (int i = 0; i < ADV_BLOB_SLOTS; i++) {     // pre-allocate to fixed size
         file.write((uint8_t *) &zeroes, sizeof(zeroes));
       }
       file.close();
@@ -344,103 +614,146 @@ void DataStore::checkAdvBlobFile() {
   }
 }
 
+int DataStore::findBlobSlot(File& file, const uint8_t key[], DataStoreHost* host, bool for_write) {
+  int home = ((uint32_t)key[0] | ((uint32_t)key[1] << 8)) % ADV_BLOB_SLOTS;
+  int found = -1, oldest_contact = -1;
+  uint32_t min_timestamp = 0xFFFFFFFF, min_contact_timestamp = 0xFFFFFFFF;
+
+  BlobRec tmp;   // NOTE: only header is read
+  const int hdr_len = sizeof(tmp.timestamp) + sizeof(tmp.key) + sizeof(tmp.len);
+  for (int i = 0; i < ADV_BLOB_PROBES; i++) {
+    int slot = (home + i) % ADV_BLOB_SLOTS;
+    file.seek(slot * sizeof(BlobRec));
+    if (file.read((uint8_t *) &tmp, hdr_len) != hdr_len) break;
+
+    if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0 && tmp.len > 0) return slot;   // only match by 7 byte prefix
+
+    if (!for_write) continue;
+    if (tmp.len == 0) {
+      min_timestamp = 0;   // empty slot, always preferred
+      found = slot;
+    } else if (host && host->isContactKey(tmp.key, sizeof(tmp.key))) {
+      if (tmp.timestamp < min_contact_timestamp) {
+        min_contact_timestamp = tmp.timestamp;
+        oldest_contact = slot;
+      }
+    } else if (tmp.timestamp < min_timestamp) {
+      min_timestamp = tmp.timestamp;   // else, evict oldest blob that isn't for a contact
+      found = slot;
+    }
+  }
+  return found >= 0 ? found : oldest_contact;   // last resort, evict least recently heard contact's blob
+}
+
+bool DataStore::writeBlobSlot(File& file, int slot, const BlobRec& rec) {
+  file.seek(slot * sizeof(BlobRec));
+  return file.write((const uint8_t *) &rec, sizeof(rec)) == sizeof(rec);
+}
+
+int DataStore::findCachedBlob(const uint8_t key[]) const {
+  for (int i = 0; i < ADV_BLOB_CACHE_SIZE; i++) {
+    if (blob_used[i] && memcmp(key, blob_cache[i].key, sizeof(blob_cache[i].key)) == 0) return i;
+  }
+  return -1;  // not found
+}
+
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  File file = _fs->open("/adv_blobs");
-  uint8_t len = 0;  // 0 = not found
+  int i = findCachedBlob(key);
+  if (i >= 0) {
+    blob_used[i] = ++blob_tick;
+    memcpy(dest_buf, blob_cache[i].data, blob_cache[i].len);
+    return blob_cache[i].len;
+  }
 
+  uint8_t len = 0;  // 0 = not found
+  File file = openBlobFile(false);
   if (file) {
-    BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
+    int slot = findBlobSlot(file, key, NULL, false);
+    if (slot >= 0) {
+      BlobRec tmp;
+      file.seek(slot * sizeof(BlobRec));
+      if (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
         len = tmp.len;
         memcpy(dest_buf, tmp.data, len);
-        break;
       }
     }
     file.close();
   }
-  return len;
-}
-
-bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
-
-  checkAdvBlobFile();
 
-  File file = _fs->open("/adv_blobs", FILE_O_WRITE);
-  if (file) {
-    uint32_t pos = 0, found_pos = 0;
-    uint32_t min_timestamp = 0xFFFFFFFF;
-
-    // search for matching key OR evict by oldest timestmap
-    BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
-      }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
+#if !defined(NRF52_PLATFORM) && !defined(STM32_PLATFORM)
+  if (len == 0) {   // fallback to blob files from older firmware
+    char path[64];
+    char fname[18];
+
+    if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
+    mesh::Utils::toHex(fname, key, key_len);
+    sprintf(path, "/bl/%s", fname);
+
+    if (_fs->exists(path)) {
+  #if defined(RP2040_PLATFORM)
+      File f = _fs->open(path, "r");
+  #else
+      File f = _fs->open(path);
+  #endif
+      if (f) {
+        len = f.read(dest_buf, 255); // currently MAX 255 byte blob len supported!!
+        f.close();
       }
-
-      pos += sizeof(tmp);
     }
-
-    memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
-    memcpy(tmp.data, src_buf, len);
-    tmp.len = len;
-    tmp.timestamp = _clock->getCurrentTime();
-
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
-
-    file.close();
-    return true;
   }
-  return false; // error
+#endif
+  return len;
 }
-#else
-uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  char path[64];
-  char fname[18];
 
-  if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
-  mesh::Utils::toHex(fname, key, key_len);
-  sprintf(path, "/bl/%s", fname);
+bool DataStore::putBlobByKey(DataStoreHost* host, const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
+  if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
 
-  if (_fs->exists(path)) {
-#if defined(RP2040_PLATFORM)
-    File f = _fs->open(path, "r");
-#else
-    File f = _fs->open(path);
-#endif
-    if (f) {
-      int len = f.read(dest_buf, 255); // currently MAX 255 byte blob len supported!!
-      f.close();
-      return len;
+  int i = findCachedBlob(key);   // coalesce with pending write of same key
+  if (i < 0) {
+    // find empty or least recently used entry
+    i = 0;
+    for (int j = 1; j < ADV_BLOB_CACHE_SIZE; j++) {
+      if (blob_used[j] < blob_used[i]) i = j;
+    }
+    if (blob_used[i] && blob_dirty[i]) {
+      flushBlobs(host);   // cache is full of pending writes, so write them all now
     }
   }
-  return 0; // not found
-}
 
-bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  char path[64];
-  char fname[18];
+  BlobRec& rec = blob_cache[i];
+  memcpy(rec.key, key, sizeof(rec.key));  // just record 7 byte prefix of key
+  memcpy(rec.data, src_buf, len);
+  rec.len = len;
+  rec.timestamp = _clock->getCurrentTime();
+  blob_used[i] = ++blob_tick;
+  blob_dirty[i] = true;
+  return true;
+}
 
-  if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
-  mesh::Utils::toHex(fname, key, key_len);
-  sprintf(path, "/bl/%s", fname);
+bool DataStore::hasDirtyBlobs() const {
+  for (int i = 0; i < ADV_BLOB_CACHE_SIZE; i++) {
+    if (blob_dirty[i]) return true;
+  }
+  return false;
+}
 
-  File f = openWrite(_fs, path);
-  if (f) {
-    int n = f.write(src_buf, len);
-    f.close();
-    if (n == len) return true; // success!
+void DataStore::flushBlobs(DataStoreHost* host) {
+  if (!hasDirtyBlobs()) return;
 
-    _fs->remove(path); // blob was only partially written!
+  checkBlobFile();
+  File file = openBlobFile(true);
+  if (file) {
+    for (int i = 0; i < ADV_BLOB_CACHE_SIZE; i++) {
+      if (!blob_dirty[i]) continue;
+
+      int slot = findBlobSlot(file, blob_cache[i].key, host, true);
+      if (slot < 0) {
+        MESH_DEBUG_PRINTLN("DataStore::flushBlobs() - no free slot (all hold contacts' blobs)");
+      } else if (!writeBlobSlot(file, slot, blob_cache[i])) {
+        MESH_DEBUG_PRINTLN("DataStore::flushBlobs() - write failed");
+      }
+      blob_dirty[i] = false;   // NOTE: don't retry forever if flash is failing
+    }
+    file.close();
   }
-  return false; // error
 }
-#endif
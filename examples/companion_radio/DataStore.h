@@ -3,12 +3,62 @@
 #include <helpers/IdentityStore.h>
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
+#include <helpers/BaseSerialInterface.h>
 #include "NodePrefs.h"
 
+#ifndef CONTACTS_JOURNAL_MAX
+  #define CONTACTS_JOURNAL_MAX   64    // records in contacts journal, before it is compacted (ie. full rewrite of contacts)
+#endif
+
+#define MAX_ADVERT_PKT_LEN   (2 + 32 + PUB_KEY_SIZE + 4 + SIGNATURE_SIZE + MAX_ADVERT_DATA_SIZE)
+
+#ifndef ADV_BLOB_CACHE_SIZE
+  #define ADV_BLOB_CACHE_SIZE   8    // advert blobs held in RAM (write-back), until flushBlobs()
+#endif
+
+static constexpr int nextPowerOf2(int n) { return n <= 1 ? 1 : 2 * nextPowerOf2((n + 1) / 2); }
+
+#ifndef ADV_BLOB_SLOTS
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define ADV_BLOB_SLOTS     32    // records in '/adv_slots' file, NOTE: fewer than contacts, so their blobs can get evicted
+  #elif defined(MAX_CONTACTS)
+    #define ADV_BLOB_SLOTS    nextPowerOf2(2*MAX_CONTACTS)   // ie. at most half full of contacts' blobs
+  #else
+    #define ADV_BLOB_SLOTS    256
+  #endif
+#endif
+
+#define ADV_BLOB_PROBES   8    // slots to search, from the slot a key hashes to
+
+#ifndef OFFLINE_LOG_SLOTS
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define OFFLINE_LOG_SLOTS     32    // records in '/offline_q' file, for offline frames overflowing the RAM queue
+  #else
+    #define OFFLINE_LOG_SLOTS     64    // ~12KB, so fits alongside the rest in a min_spiffs (128KB) partition
+  #endif
+#endif
+
+struct BlobRec {
+  uint32_t timestamp;
+  uint8_t  key[7];
+  uint8_t  len;
+  uint8_t  data[MAX_ADVERT_PKT_LEN];
+};
+
+struct OfflineRec {
+  uint32_t seq;
+  uint8_t  len;
+  uint8_t  check[4];   // hash of seq, len and frame, to detect a torn write
+  uint8_t  frame[MAX_FRAME_SIZE];
+};
+
 class DataStoreHost {
 public:
   virtual bool onContactLoaded(const ContactInfo& contact) =0;
   virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
+  virtual bool getContactByKey(const uint8_t* pub_key, ContactInfo& contact) =0;   // false if no longer exists
+  virtual void onContactDeleted(const uint8_t* pub_key) =0;   // when replaying journal
+  virtual bool isContactKey(const uint8_t* key, int key_len) =0;   // so their advert blobs are only evicted as a last resort
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
@@ -18,10 +68,19 @@ class DataStore {
   mesh::RTCClock* _clock;
   IdentityStore identity_store;
 
+  BlobRec blob_cache[ADV_BLOB_CACHE_SIZE];
+  uint32_t blob_used[ADV_BLOB_CACHE_SIZE];   // for LRU, 0 = empty
+  bool blob_dirty[ADV_BLOB_CACHE_SIZE];
+  uint32_t blob_tick;
+  int num_journal_recs;
+
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  void checkAdvBlobFile();
-#endif
+  void checkBlobFile();
+  File openBlobFile(bool for_write);
+  void migrateBlobs(const char* filename);
+  int  findBlobSlot(File& file, const uint8_t key[], DataStoreHost* host, bool for_write);
+  bool writeBlobSlot(File& file, int slot, const BlobRec& rec);
+  int  findCachedBlob(const uint8_t key[]) const;
 
 public:
   DataStore(FILESYSTEM& fs, mesh::RTCClock& clock);
@@ -32,11 +91,33 @@ public:
   void loadPrefs(NodePrefs& prefs, double& node_lat, double& node_lon);
   void savePrefs(const NodePrefs& prefs, double node_lat, double node_lon);
   void loadContacts(DataStoreHost* host);
-  void saveContacts(DataStoreHost* host);
+  void saveContacts(DataStoreHost* host);   // full rewrite, and clears journal
+
+  /**
+   * \brief  append latest version of the given contacts to journal (or a delete, if host no longer has them).
+   *          If journal has grown too big, does saveContacts() instead.
+   */
+  void saveContactChanges(DataStoreHost* host, const uint8_t pub_keys[][PUB_KEY_SIZE], int num);
   void loadChannels(DataStoreHost* host);
   void saveChannels(DataStoreHost* host);
   uint8_t getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]);
-  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
+  bool putBlobByKey(DataStoreHost* host, const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len);
+  bool hasDirtyBlobs() const;
+  void flushBlobs(DataStoreHost* host);   // write all dirty cached blobs to flash, in one pass
+
+  /**
+   * \brief  offline frames log. A ring of OFFLINE_LOG_SLOTS records, at slot 'seq' % OFFLINE_LOG_SLOTS. The next 'seq'
+   *         to be read is persisted separately, so replay (after a crash) may repeat frames, but won't lose them.
+   */
+  void loadOfflineLog(uint32_t& read_seq, uint32_t& write_seq);
+  bool writeOfflineFrame(uint32_t seq, const uint8_t frame[], uint8_t len);
+  int  readOfflineFrame(uint32_t seq, uint8_t frame[]);   // 0 if record was overwritten or torn
+  void saveOfflineReadSeq(uint32_t read_seq);
+  void clearOfflineLog();
+#ifdef MAX_COLD_CONTACTS
+  bool writeSwapContact(int slot, const ContactInfo& contact);
+  bool readSwapContact(int slot, ContactInfo& contact);
+#endif
   File openRead(const char* filename);
   bool removeFile(const char* filename);
   uint32_t getStorageUsedKb() const;
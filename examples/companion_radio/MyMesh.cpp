@@ -49,6 +49,9 @@
 // NOTE: CMD range 44..49 parked, potentially for WiFi operations
 #define CMD_SEND_BINARY_REQ           50
 #define CMD_FACTORY_RESET             51
+#define CMD_GET_LINK_QUALITY          52
+#define CMD_SEARCH_CONTACTS           53
+#define CMD_GET_CONTACTS_BULK         54 // as per CMD_GET_CONTACTS, but packed/compact frames
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -74,12 +77,16 @@
 #define RESP_CODE_CUSTOM_VARS         21
 #define RESP_CODE_ADVERT_PATH         22
 #define RESP_CODE_TUNING_PARAMS       23
+#define RESP_CODE_LINK_QUALITY        24 // a reply to CMD_GET_LINK_QUALITY
+#define RESP_CODE_CONTACT_SEARCH      25 // a reply to CMD_SEARCH_CONTACTS
+#define RESP_CODE_CONTACTS_BULK       26 // multiple of these (after CMD_GET_CONTACTS_BULK)
 
 #define SEND_TIMEOUT_BASE_MILLIS        500
 #define FLOOD_SEND_TIMEOUT_FACTOR       16.0f
 #define DIRECT_SEND_PERHOP_FACTOR       6.0f
 #define DIRECT_SEND_PERHOP_EXTRA_MILLIS 250
 #define LAZY_CONTACTS_WRITE_DELAY       5000
+#define LAZY_BLOBS_WRITE_DELAY         60000   // batch up advert blob writes
 
 #define PUBLIC_GROUP_PSK                "izOH6cXN6mrJ5e26oRXNcg=="
 
@@ -136,8 +143,18 @@ void MyMesh::writeContactRespFrame(uint8_t code, const ContactInfo &contact) {
   i += PUB_KEY_SIZE;
   out_frame[i++] = contact.type;
   out_frame[i++] = contact.flags;
-  out_frame[i++] = contact.out_path_len;
-  memcpy(&out_frame[i], contact.out_path, MAX_PATH_SIZE);
+  if (contact.out_path_len > 0 && contact.out_path_ver == PAYLOAD_VER_2) {
+    // app only knows 1-byte path hashes, so just give it the first byte of each
+    uint8_t hops = contact.out_path_len / PATH_HASH_SIZE_V2;
+    out_frame[i++] = hops;
+    memset(&out_frame[i], 0, MAX_PATH_SIZE);
+    for (int k = 0; k < hops; k++) {
+      out_frame[i + k] = contact.out_path[k * PATH_HASH_SIZE_V2];
+    }
+  } else {
+    out_frame[i++] = contact.out_path_len;
+    memcpy(&out_frame[i], contact.out_path, MAX_PATH_SIZE);
+  }
   i += MAX_PATH_SIZE;
   StrHelper::strzcpy((char *)&out_frame[i], contact.name, 32);
   i += 32;
@@ -152,6 +169,111 @@ void MyMesh::writeContactRespFrame(uint8_t code, const ContactInfo &contact) {
   _serial->writeFrame(out_frame, i);
 }
 
+/*
+ * Compact contact record, for RESP_CODE_CONTACTS_BULK frames. Path and name are variable length, GPS only if known:
+ *   [rec_flags][pub_key:32][type][flags][out_path_len (0xFF = unknown)][out_path][name_len][name]
+ *   [last_advert_timestamp:4][lastmod:4] { [gps_lat:4][gps_lon:4] if (rec_flags & BULK_REC_HAS_GPS) }
+ */
+#define BULK_REC_HAS_GPS   0x01
+
+static int encodeBulkContact(uint8_t* dest, int max_len, const ContactInfo& contact) {
+  uint8_t path[MAX_PATH_SIZE];
+  int path_len = contact.out_path_len;
+  if (path_len > 0 && contact.out_path_ver == PAYLOAD_VER_2) {
+    // app only knows 1-byte path hashes, so just give it the first byte of each
+    path_len /= PATH_HASH_SIZE_V2;
+    for (int k = 0; k < path_len; k++) {
+      path[k] = contact.out_path[k * PATH_HASH_SIZE_V2];
+    }
+  } else if (path_len > 0) {
+    memcpy(path, contact.out_path, path_len);
+  }
+  int name_len = strnlen(contact.name, sizeof(contact.name) - 1);
+  bool has_gps = contact.gps_lat != 0 || contact.gps_lon != 0;
+
+  int len = 1 + PUB_KEY_SIZE + 3 + (path_len > 0 ? path_len : 0) + 1 + name_len + 8 + (has_gps ? 8 : 0);
+  if (len > max_len) return 0;   // won't fit
+
+  int i = 0;
+  dest[i++] = has_gps ? BULK_REC_HAS_GPS : 0;
+  memcpy(&dest[i], contact.id.pub_key, PUB_KEY_SIZE); i += PUB_KEY_SIZE;
+  dest[i++] = contact.type;
+  dest[i++] = contact.flags;
+  dest[i++] = path_len < 0 ? 0xFF : path_len;
+  if (path_len > 0) {
+    memcpy(&dest[i], path, path_len); i += path_len;
+  }
+  dest[i++] = name_len;
+  memcpy(&dest[i], contact.name, name_len); i += name_len;
+  memcpy(&dest[i], &contact.last_advert_timestamp, 4); i += 4;
+  memcpy(&dest[i], &contact.lastmod, 4); i += 4;
+  if (has_gps) {
+    memcpy(&dest[i], &contact.gps_lat, 4); i += 4;
+    memcpy(&dest[i], &contact.gps_lon, 4); i += 4;
+  }
+  return i;
+}
+
+// RESP_CODE_CONTACT_SEARCH entries, as many as fit: [pub_key:32][type][name_len][name]
+#define SEARCH_ENTRIES_MAX   ((MAX_FRAME_SIZE - 5) / (PUB_KEY_SIZE + 2) + 1)   // +1, to know if there are more
+
+class SearchResultsWriter : public ContactVisitor {
+  uint8_t* _frame;
+public:
+  int len, count;
+  bool full;
+
+  SearchResultsWriter(uint8_t* frame, int start) : _frame(frame), len(start), count(0), full(false) { }
+
+  void onContactVisit(const ContactInfo& contact) override {
+    int nlen = strnlen(contact.name, sizeof(contact.name) - 1);
+    if (full || len + PUB_KEY_SIZE + 2 + nlen > MAX_FRAME_SIZE) {
+      full = true;   // app can ask again, with skip + count
+      return;
+    }
+    memcpy(&_frame[len], contact.id.pub_key, PUB_KEY_SIZE); len += PUB_KEY_SIZE;
+    _frame[len++] = contact.type;
+    _frame[len++] = nlen;
+    memcpy(&_frame[len], contact.name, nlen); len += nlen;
+    count++;
+  }
+};
+
+void MyMesh::writeBulkContactsFrame() {
+  int i = 0;
+  out_frame[i++] = RESP_CODE_CONTACTS_BULK;
+  int count_idx = i++;
+  int n = 0;
+
+  ContactInfo contact;
+  while (true) {
+    ContactsIterator prev = _iter;   // so a contact that doesn't fit can go in next frame
+    if (!_iter.hasNext(this, contact)) break;
+    if (contact.lastmod <= _iter_filter_since) continue;   // apply the 'since' filter
+
+    int len = encodeBulkContact(&out_frame[i], MAX_FRAME_SIZE - i, contact);
+    if (len == 0) {
+      _iter = prev;   // frame is full
+      break;
+    }
+    i += len;
+    n++;
+    if (contact.lastmod > _most_recent_lastmod) {
+      _most_recent_lastmod = contact.lastmod; // save for the RESP_CODE_END_OF_CONTACTS frame
+    }
+  }
+
+  if (n > 0) {
+    out_frame[count_idx] = n;
+    _serial->writeFrame(out_frame, i);
+  } else { // EOF
+    out_frame[0] = RESP_CODE_END_OF_CONTACTS;
+    memcpy(&out_frame[1], &_most_recent_lastmod, 4);
+    _serial->writeFrame(out_frame, 5);
+    _iter_started = false;
+  }
+}
+
 void MyMesh::updateContactFromFrame(ContactInfo &contact, const uint8_t *frame, int len) {
   int i = 0;
   uint8_t code = frame[i++]; // eg. CMD_ADD_UPDATE_CONTACT
@@ -161,6 +283,7 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, const uint8_t *frame,
   contact.flags = frame[i++];
   contact.out_path_len = frame[i++];
   memcpy(contact.out_path, &frame[i], MAX_PATH_SIZE);
+  contact.out_path_ver = PAYLOAD_VER_1;   // app paths are always 1-byte hashes
   i += MAX_PATH_SIZE;
   memcpy(contact.name, &frame[i], 32);
   i += 32;
@@ -175,27 +298,58 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, const uint8_t *frame,
 }
 
 void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
+  if (offline_queue_len >= OFFLINE_QUEUE_SIZE && !spillOfflineFrame()) {
     MESH_DEBUG_PRINTLN("ERROR: offline_queue is full!");
   } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
+    int i = (offline_queue_head + offline_queue_len) % OFFLINE_QUEUE_SIZE;
+    offline_queue[i].len = len;
+    memcpy(offline_queue[i].buf, frame, len);
     offline_queue_len++;
+    if (offline_queue_expiry == 0) offline_queue_expiry = futureMillis(OFFLINE_QUEUE_WRITE_DELAY);
   }
 }
-int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
+bool MyMesh::spillOfflineFrame() {  // move oldest frame in RAM to end of offline log
+  if (offline_log_write - offline_log_read >= OFFLINE_LOG_SLOTS) return false;  // log is full
+
+  Frame& f = offline_queue[offline_queue_head];
+  if (!_store->writeOfflineFrame(offline_log_write, f.buf, f.len)) return false;
 
+  offline_log_write++;
+  offline_queue_head = (offline_queue_head + 1) % OFFLINE_QUEUE_SIZE;
+  offline_queue_len--;
+  return true;
+}
+int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
+  while (offline_log_read != offline_log_write) {   // oldest frames are in the log
+    int len = _store->readOfflineFrame(offline_log_read++, frame);
+    offline_log_pos_dirty = true;
+    if (offline_queue_expiry == 0) offline_queue_expiry = futureMillis(OFFLINE_QUEUE_WRITE_DELAY);
+    if (len > 0) return len;
+    // else, torn record (from a crash), skip it
+  }
+  if (offline_queue_len > 0) {
+    Frame& f = offline_queue[offline_queue_head];
+    memcpy(frame, f.buf, f.len);
+    offline_queue_head = (offline_queue_head + 1) % OFFLINE_QUEUE_SIZE;
     offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
-    }
-    return len;
+    return f.len;
   }
   return 0; // queue is empty
 }
+void MyMesh::flushOfflineQueue() {
+  if (offline_log_pos_dirty && offline_log_read == offline_log_write) {   // log fully read, start afresh
+    _store->clearOfflineLog();
+    offline_log_read = offline_log_write = 0;
+    offline_log_pos_dirty = false;
+  }
+  while (offline_queue_len > 0 && spillOfflineFrame()) { }   // so frames survive a reboot/crash
+
+  if (offline_log_pos_dirty) {
+    _store->saveOfflineReadSeq(offline_log_read);
+    offline_log_pos_dirty = false;
+  }
+  offline_queue_expiry = 0;
+}
 
 float MyMesh::getAirtimeBudgetFactor() const {
   return _prefs.airtime_factor;
@@ -207,7 +361,58 @@ int MyMesh::getInterferenceThreshold() const {
 
 int MyMesh::calcRxDelay(float score, uint32_t air_time) const {
   if (_prefs.rx_delay_base <= 0.0f) return 0;
-  return (int)((pow(_prefs.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+  return calcScoreDelay(_prefs.rx_delay_base, score, air_time);
+}
+
+bool MyMesh::onContactLoaded(const ContactInfo& contact) {
+  ContactInfo* existing = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (existing) removeContact(*existing);   // replaced by later version (from journal)
+  return addContact(contact);
+}
+
+bool MyMesh::getContactByKey(const uint8_t* pub_key, ContactInfo& contact) {
+  ContactInfo* c = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
+  if (c == NULL) return false;
+
+  contact = *c;
+  return true;
+}
+
+void MyMesh::onContactDeleted(const uint8_t* pub_key) {
+  ContactInfo* c = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
+  if (c) removeContact(*c);
+}
+
+void MyMesh::markContactDirty(const uint8_t* pub_key) {
+  dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+
+  if (num_dirty_contacts < 0) return;   // already need full save
+  for (int i = 0; i < num_dirty_contacts; i++) {
+    if (memcmp(dirty_contact_keys[i], pub_key, PUB_KEY_SIZE) == 0) return;   // already pending
+  }
+  if (num_dirty_contacts < MAX_DIRTY_CONTACTS) {
+    memcpy(dirty_contact_keys[num_dirty_contacts++], pub_key, PUB_KEY_SIZE);
+  } else {
+    num_dirty_contacts = -1;   // too many, just rewrite the lot
+  }
+}
+
+void MyMesh::saveContactChanges() {
+  if (num_dirty_contacts < 0) {
+    saveContacts();
+  } else if (num_dirty_contacts > 0) {
+    _store->saveContactChanges(this, dirty_contact_keys, num_dirty_contacts);
+    flushBlobs();   // new contacts' adverts, so 'share contact' works after a crash
+  }
+  num_dirty_contacts = 0;
+  dirty_contacts_expiry = 0;
+}
+
+bool MyMesh::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) {
+  if (!_store->putBlobByKey(this, key, key_len, src_buf, len)) return false;
+
+  if (dirty_blobs_expiry == 0) dirty_blobs_expiry = futureMillis(LAZY_BLOBS_WRITE_DELAY);   // write-back later, in a batch
+  return true;
 }
 
 uint8_t MyMesh::getExtraAckTransmitCount() const {
@@ -231,6 +436,10 @@ bool MyMesh::isAutoAddEnabled() const {
   return (_prefs.manual_add_contacts & 1) == 0;
 }
 
+bool MyMesh::isTextCompressionEnabled() const {
+  return _prefs.text_compression != 0;
+}
+
 void MyMesh::onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path_len, const uint8_t* path) {
   if (_serial->isConnected()) {
     if (!isAutoAddEnabled() && is_new) {
@@ -267,7 +476,7 @@ void MyMesh::onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path
     memcpy(p->path, path, p->path_len);
   }
 
-  dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+  markContactDirty(contact.id.pub_key);
 }
 
 void MyMesh::onContactPathUpdated(const ContactInfo &contact) {
@@ -275,7 +484,7 @@ void MyMesh::onContactPathUpdated(const ContactInfo &contact) {
   memcpy(&out_frame[1], contact.id.pub_key, PUB_KEY_SIZE);
   _serial->writeFrame(out_frame, 1 + PUB_KEY_SIZE); // NOTE: app may not be connected
 
-  dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+  markContactDirty(contact.id.pub_key);
 }
 
 bool MyMesh::processAck(const uint8_t *data) {
@@ -288,6 +497,10 @@ bool MyMesh::processAck(const uint8_t *data) {
       memcpy(&out_frame[5], &trip_time, 4);
       _serial->writeFrame(out_frame, 9);
 
+      if (expected_ack_table[i].first_hop_len > 0) {
+        getTables()->onLinkDelivery(expected_ack_table[i].first_hop, expected_ack_table[i].first_hop_len, true);
+      }
+
       // NOTE: the same ACK can be received multiple times!
       expected_ack_table[i].ack = 0; // clear expected hash, now that we have received ACK
       return true;
@@ -335,7 +548,7 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display) {
-    ui_task.newMsg(path_len, from.name, text, offline_queue_len);
+    ui_task.newMsg(path_len, from.name, text, getNumOfflineMessages());
     if (!_serial->isConnected()) {
       ui_task.soundBuzzer(UIEventType::contactMessage);
     }
@@ -359,7 +572,7 @@ void MyMesh::onSignedMessageRecv(const ContactInfo &from, mesh::Packet *pkt, uin
                                  const uint8_t *sender_prefix, const char *text) {
   markConnectionActive(from);
   // from.sync_since change needs to be persisted
-  dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+  markContactDirty(from.id.pub_key);
   queueMessage(from, TXT_TYPE_SIGNED_PLAIN, pkt, sender_timestamp, sender_prefix, 4, text);
 }
 
@@ -406,7 +619,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  ui_task.newMsg(path_len, channel_name, text, offline_queue_len);
+  ui_task.newMsg(path_len, channel_name, text, getNumOfflineMessages());
 #endif
 }
 
@@ -583,13 +796,20 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
       _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store) {
   _iter_started = false;
+  _iter_bulk = false;
   _cli_rescue = false;
-  offline_queue_len = 0;
+  offline_queue_head = offline_queue_len = 0;
+  offline_log_read = offline_log_write = 0;
+  offline_log_pos_dirty = false;
+  offline_queue_expiry = 0;
   app_target_ver = 0;
   pending_login = pending_status = pending_telemetry = pending_req = 0;
   next_ack_idx = 0;
+  memset(expected_ack_table, 0, sizeof(expected_ack_table));
   sign_data = NULL;
   dirty_contacts_expiry = 0;
+  num_dirty_contacts = 0;
+  dirty_blobs_expiry = 0;
   memset(advert_paths, 0, sizeof(advert_paths));
 
   // defaults
@@ -659,6 +879,7 @@ void MyMesh::begin(bool has_display) {
 #endif
 
   _store->loadContacts(this);
+  _store->loadOfflineLog(offline_log_read, offline_log_write);   // replay frames not yet synced, from before reboot
   addChannel("Public", PUBLIC_GROUP_PSK); // pre-configure Andy's public channel
   _store->loadChannels(this);
 
@@ -770,8 +991,17 @@ void MyMesh::handleCmdFrame(size_t len) {
         writeErrFrame(ERR_CODE_TABLE_FULL);
       } else {
         if (expected_ack) {
-          expected_ack_table[next_ack_idx].msg_sent = _ms->getMillis(); // add to circular table
-          expected_ack_table[next_ack_idx].ack = expected_ack;
+          auto e = &expected_ack_table[next_ack_idx];
+          e->msg_sent = _ms->getMillis(); // add to circular table
+          e->ack = expected_ack;
+          e->timeout = est_timeout;
+          e->first_hop_len = 0;
+          if (result == MSG_SEND_SENT_DIRECT) {
+            uint8_t hash_size = mesh::Packet::getPathHashSizeFor(recipient->out_path_ver);
+            // NOTE: zero hop path means recipient is the first hop
+            memcpy(e->first_hop, recipient->out_path_len > 0 ? recipient->out_path : recipient->id.pub_key, hash_size);
+            e->first_hop_len = hash_size;
+          }
           next_ack_idx = (next_ack_idx + 1) % EXPECTED_ACK_TABLE_SIZE;
         }
 
@@ -806,7 +1036,7 @@ void MyMesh::handleCmdFrame(size_t len) {
         writeErrFrame(ERR_CODE_NOT_FOUND); // bad channel_idx
       }
     }
-  } else if (cmd_frame[0] == CMD_GET_CONTACTS) { // get Contact list
+  } else if (cmd_frame[0] == CMD_GET_CONTACTS || cmd_frame[0] == CMD_GET_CONTACTS_BULK) { // get Contact list
     if (_iter_started) {
       writeErrFrame(ERR_CODE_BAD_STATE); // iterator is currently busy
     } else {
@@ -825,6 +1055,7 @@ void MyMesh::handleCmdFrame(size_t len) {
       // start iterator
       _iter = startContactsIterator();
       _iter_started = true;
+      _iter_bulk = cmd_frame[0] == CMD_GET_CONTACTS_BULK;
       _most_recent_lastmod = 0;
     }
   } else if (cmd_frame[0] == CMD_SET_ADVERT_NAME && len >= 2) {
@@ -888,7 +1119,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if (recipient) {
       recipient->out_path_len = -1;
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
-      dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+      markContactDirty(pub_key);
       writeOKFrame();
     } else {
       writeErrFrame(ERR_CODE_NOT_FOUND); // unknown contact
@@ -898,16 +1129,18 @@ void MyMesh::handleCmdFrame(size_t len) {
     ContactInfo *recipient = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
     if (recipient) {
       updateContactFromFrame(*recipient, cmd_frame, len);
+      updateContactIndexes(*recipient);
       // recipient->lastmod = ??   shouldn't be needed, app already has this version of contact
-      dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+      markContactDirty(pub_key);
       writeOKFrame();
     } else {
       ContactInfo contact;
+      memset(&contact, 0, sizeof(contact));
       updateContactFromFrame(contact, cmd_frame, len);
       contact.lastmod = getRTCClock()->getCurrentTime();
       contact.sync_since = 0;
       if (addContact(contact)) {
-        dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+        markContactDirty(contact.id.pub_key);
         writeOKFrame();
       } else {
         writeErrFrame(ERR_CODE_TABLE_FULL);
@@ -917,7 +1150,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     uint8_t *pub_key = &cmd_frame[1];
     ContactInfo *recipient = lookupContactByPubKey(pub_key, PUB_KEY_SIZE);
     if (recipient && removeContact(*recipient)) {
-      dirty_contacts_expiry = futureMillis(LAZY_CONTACTS_WRITE_DELAY);
+      markContactDirty(pub_key);
       writeOKFrame();
     } else {
       writeErrFrame(ERR_CODE_NOT_FOUND); // not found, or unable to remove
@@ -983,7 +1216,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
       _serial->writeFrame(out_frame, out_len);
 #ifdef DISPLAY_CLASS
-      ui_task.msgRead(offline_queue_len);
+      ui_task.msgRead(getNumOfflineMessages());
 #endif
     } else {
       out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
@@ -1056,6 +1289,9 @@ void MyMesh::handleCmdFrame(size_t len) {
         _prefs.advert_loc_policy = cmd_frame[3];
         if (len >= 5) {
           _prefs.multi_acks = cmd_frame[4];
+          if (len >= 6) {
+            _prefs.text_compression = cmd_frame[5];
+          }
         }
       }
     }
@@ -1063,8 +1299,10 @@ void MyMesh::handleCmdFrame(size_t len) {
     writeOKFrame();
   } else if (cmd_frame[0] == CMD_REBOOT && memcmp(&cmd_frame[1], "reboot", 6) == 0) {
     if (dirty_contacts_expiry) { // is there are pending dirty contacts write needed?
-      saveContacts();
+      saveContactChanges();
     }
+    flushBlobs();
+    flushOfflineQueue();
     board.reboot();
   } else if (cmd_frame[0] == CMD_GET_BATT_AND_STORAGE) {
     uint8_t reply[11];
@@ -1349,6 +1587,42 @@ void MyMesh::handleCmdFrame(size_t len) {
     } else {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG);
     }
+  } else if (cmd_frame[0] == CMD_GET_LINK_QUALITY) {
+    int start = len >= 2 ? cmd_frame[1] : 0;
+    int total = getTables()->getNumLinks();
+    int i = 0;
+    out_frame[i++] = RESP_CODE_LINK_QUALITY;
+    out_frame[i++] = total;
+    int count_idx = i++;
+    int n = 0;
+    for (int k = start; k < total && i + 7 <= MAX_FRAME_SIZE; k++, n++) {
+      auto l = getTables()->getLinkByIdx(k);
+      memcpy(&out_frame[i], l->hash, 2); i += 2;   // NOTE: second byte is zero if only 1-byte hash known
+      out_frame[i++] = (int8_t)(l->snr * 4);
+      out_frame[i++] = (uint8_t)(l->delivery * 255);
+      uint16_t etx = l->getETX() * 10;
+      memcpy(&out_frame[i], &etx, 2); i += 2;
+      out_frame[i++] = l->n_sent > 255 ? 255 : l->n_sent;
+    }
+    out_frame[count_idx] = n;
+    _serial->writeFrame(out_frame, i);
+  } else if (cmd_frame[0] == CMD_SEARCH_CONTACTS && len >= 3) {
+    uint16_t skip;
+    memcpy(&skip, &cmd_frame[1], 2);
+    char prefix[32];
+    int plen = len - 3;
+    if (plen > (int)sizeof(prefix) - 1) plen = sizeof(prefix) - 1;
+    memcpy(prefix, &cmd_frame[3], plen);
+    prefix[plen] = 0;
+
+    int i = 0;
+    out_frame[i++] = RESP_CODE_CONTACT_SEARCH;
+    memcpy(&out_frame[i], &skip, 2); i += 2;
+    SearchResultsWriter results(out_frame, i + 2);   // after [count][more]
+    searchContactsByName(prefix, &results, SEARCH_ENTRIES_MAX, skip);
+    out_frame[i++] = results.count;
+    out_frame[i++] = results.full ? 1 : 0;
+    _serial->writeFrame(out_frame, results.len);
   } else if (cmd_frame[0] == CMD_GET_ADVERT_PATH && len >= PUB_KEY_SIZE+2) {
     // FUTURE use:  uint8_t reserved = cmd_frame[1];
     uint8_t *pub_key = &cmd_frame[2];
@@ -1518,7 +1792,9 @@ void MyMesh::checkSerialInterface() {
              && !_serial->isWriteBusy() // don't spam the Serial Interface too quickly!
   ) {
     ContactInfo contact;
-    if (_iter.hasNext(this, contact)) {
+    if (_iter_bulk) {
+      writeBulkContactsFrame();
+    } else if (_iter.hasNext(this, contact)) {
       if (contact.lastmod > _iter_filter_since) { // apply the 'since' filter
         writeContactRespFrame(RESP_CODE_CONTACT, contact);
         if (contact.lastmod > _most_recent_lastmod) {
@@ -1537,6 +1813,16 @@ void MyMesh::checkSerialInterface() {
   }
 }
 
+void MyMesh::checkAckTimeouts() {
+  for (int i = 0; i < EXPECTED_ACK_TABLE_SIZE; i++) {
+    auto e = &expected_ack_table[i];
+    if (e->ack && e->first_hop_len > 0 && millisHasNowPassed(e->msg_sent + e->timeout)) {
+      getTables()->onLinkDelivery(e->first_hop, e->first_hop_len, false);
+      e->first_hop_len = 0;   // only count once (ACK may still arrive late)
+    }
+  }
+}
+
 void MyMesh::loop() {
   BaseChatMesh::loop();
 
@@ -1546,10 +1832,17 @@ void MyMesh::loop() {
     checkSerialInterface();
   }
 
+  checkAckTimeouts();
+
   // is there are pending dirty contacts write needed?
   if (dirty_contacts_expiry && millisHasNowPassed(dirty_contacts_expiry)) {
-    saveContacts();
-    dirty_contacts_expiry = 0;
+    saveContactChanges();
+  }
+  if (dirty_blobs_expiry && millisHasNowPassed(dirty_blobs_expiry)) {
+    flushBlobs();
+  }
+  if (offline_queue_expiry && millisHasNowPassed(offline_queue_expiry)) {
+    flushOfflineQueue();
   }
 
 #ifdef DISPLAY_CLASS
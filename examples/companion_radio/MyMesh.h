@@ -62,7 +62,15 @@
 #endif
 
 #ifndef OFFLINE_QUEUE_SIZE
-#define OFFLINE_QUEUE_SIZE 16
+#define OFFLINE_QUEUE_SIZE 16   // frames held in RAM, older ones spill to DataStore's offline log
+#endif
+
+#ifndef OFFLINE_QUEUE_WRITE_DELAY
+#define OFFLINE_QUEUE_WRITE_DELAY 30000   // millis, before frames still in RAM are also persisted
+#endif
+
+#ifndef MAX_DIRTY_CONTACTS
+#define MAX_DIRTY_CONTACTS 16   // changes journaled individually, more than this (per save) does a full rewrite
 #endif
 
 #ifndef BLE_NAME_PREFIX
@@ -101,6 +109,7 @@ protected:
 
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
   bool isAutoAddEnabled() const override;
+  bool isTextCompressionEnabled() const override;
   void onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path_len, const uint8_t* path) override;
   void onContactPathUpdated(const ContactInfo &contact) override;
   bool processAck(const uint8_t *data) override;
@@ -128,8 +137,11 @@ protected:
   void onSendTimeout() override;
 
   // DataStoreHost methods
-  bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
+  bool onContactLoaded(const ContactInfo& contact) override;
   bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
+  bool getContactByKey(const uint8_t* pub_key, ContactInfo& contact) override;
+  void onContactDeleted(const uint8_t* pub_key) override;
+  bool isContactKey(const uint8_t* key, int key_len) override { return hasContact(key, key_len); }
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
 
@@ -138,23 +150,37 @@ private:
   void writeErrFrame(uint8_t err_code);
   void writeDisabledFrame();
   void writeContactRespFrame(uint8_t code, const ContactInfo &contact);
+  void writeBulkContactsFrame();
   void updateContactFromFrame(ContactInfo &contact, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
+  bool spillOfflineFrame();
+  void flushOfflineQueue();
+  int getNumOfflineMessages() const { return offline_queue_len + (int)(offline_log_write - offline_log_read); }
   int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override { 
     return _store->getBlobByKey(key, key_len, dest_buf);
   }
-  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override {
-    return _store->putBlobByKey(key, key_len, src_buf, len);
+  bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) override;
+#ifdef MAX_COLD_CONTACTS
+  bool writeColdContact(int cold_slot, const ContactInfo& contact) override {
+    return _store->writeSwapContact(cold_slot, contact);
+  }
+  bool readColdContact(int cold_slot, ContactInfo& dest) const override {
+    return _store->readSwapContact(cold_slot, dest);
   }
+#endif
 
   void checkCLIRescueCmd();
   void checkSerialInterface();
+  void checkAckTimeouts();
 
   // helpers, short-cuts
   void savePrefs() { _store->savePrefs(_prefs, sensors.node_lat, sensors.node_lon); }
   void saveChannels() { _store->saveChannels(this); }
-  void saveContacts() { _store->saveContacts(this); }
+  void saveContacts() { _store->saveContacts(this); flushBlobs(); }
+  void flushBlobs() { _store->flushBlobs(this); dirty_blobs_expiry = 0; }
+  void markContactDirty(const uint8_t* pub_key);
+  void saveContactChanges();
 
 private:
   DataStore* _store;
@@ -170,12 +196,16 @@ private:
   uint32_t _most_recent_lastmod;
   uint32_t _active_ble_pin;
   bool _iter_started;
+  bool _iter_bulk;   // RESP_CODE_CONTACTS_BULK frames, instead of RESP_CODE_CONTACT
   bool _cli_rescue;
   char cli_command[80];
   uint8_t app_target_ver;
   uint8_t *sign_data;
   uint32_t sign_data_len;
   unsigned long dirty_contacts_expiry;
+  uint8_t dirty_contact_keys[MAX_DIRTY_CONTACTS][PUB_KEY_SIZE];   // changed/removed since last save
+  int num_dirty_contacts;   // -1 = too many, need full save
+  unsigned long dirty_blobs_expiry;
 
   uint8_t cmd_frame[MAX_FRAME_SIZE + 1];
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
@@ -185,12 +215,18 @@ private:
     uint8_t len;
     uint8_t buf[MAX_FRAME_SIZE];
   };
-  int offline_queue_len;
+  int offline_queue_head, offline_queue_len;   // ring buffer
   Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  uint32_t offline_log_read, offline_log_write;   // seq numbers in offline log, all older than frames in RAM
+  bool offline_log_pos_dirty;
+  unsigned long offline_queue_expiry;
 
   struct AckTableEntry {
     unsigned long msg_sent;
     uint32_t ack;
+    uint32_t timeout;
+    uint8_t first_hop[MAX_PATH_HASH_SIZE];   // for link quality, if sent direct
+    uint8_t first_hop_len;
   };
   #define EXPECTED_ACK_TABLE_SIZE 8
   AckTableEntry expected_ack_table[EXPECTED_ACK_TABLE_SIZE]; // circular table
@@ -98,6 +98,12 @@ struct RepeaterStats {
   uint16_t err_events;                // was 'n_full_events'
   int16_t  last_snr;   // x 4
   uint16_t n_direct_dups, n_flood_dups;
+  uint16_t chan_util;      // percent x 10
+  uint16_t load_stretch;   // x 100
+  uint16_t n_cad_deferrals, n_cad_forced;
+  uint16_t n_stale_tx, n_stale_rx;
+  uint16_t n_queue_drops[QUEUE_DROP_CLASSES];   // outbound packets dropped when pool ran out, by priority class
+  uint16_t n_rx_backlog, n_rx_dropped;   // radio RX ring
 };
 
 struct ClientInfo {
@@ -107,6 +113,7 @@ struct ClientInfo {
   bool    is_admin;
   int8_t  out_path_len;
   uint8_t out_path[MAX_PATH_SIZE];
+  uint8_t out_path_ver;   // PAYLOAD_VER_* of out_path
 };
 
 #ifndef MAX_CLIENTS
@@ -153,10 +160,15 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
 
     oldest->id = id;
     oldest->out_path_len = -1;  // initially out_path is unknown
+    oldest->out_path_ver = PAYLOAD_VER_1;
     oldest->last_timestamp = 0;
     return oldest;
   }
 
+  static uint8_t getReplyVer(const ClientInfo* client, const mesh::Packet* packet) {
+    return client->out_path_len >= 0 ? client->out_path_ver : packet->getPayloadVer();   // must match hash size in out_path
+  }
+
   void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr) {
   #if MAX_NEIGHBOURS    // check if neighbours enabled    
     // find existing neighbour, else use least recently updated
@@ -208,6 +220,18 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
         stats.last_snr = (int16_t)(radio_driver.getLastSNR() * 4);
         stats.n_direct_dups = ((SimpleMeshTables *)getTables())->getNumDirectDups();
         stats.n_flood_dups = ((SimpleMeshTables *)getTables())->getNumFloodDups();
+        stats.chan_util = getChannelUtilisation() * 10;
+        stats.load_stretch = getChannelLoadStretch() * 100;
+        stats.n_cad_deferrals = getNumCADDeferrals();
+        stats.n_cad_forced = getNumCADForced();
+        stats.n_stale_tx = getNumStaleTx();
+        stats.n_stale_rx = getNumStaleRx();
+        {
+          auto mgr = (StaticPoolPacketManager *) _mgr;
+          for (int i = 0; i < QUEUE_DROP_CLASSES; i++) stats.n_queue_drops[i] = mgr->getNumTxDrops(i);
+        }
+        stats.n_rx_backlog = _radio->getRecvBacklog();
+        stats.n_rx_dropped = _radio->getRecvDropped();
 
         memcpy(&reply_data[4], &stats, sizeof(stats));
 
@@ -255,7 +279,7 @@ protected:
 
   bool allowPacketForward(const mesh::Packet* packet) override {
     if (_prefs.disable_fwd) return false;
-    if (packet->isRouteFlood() && packet->path_len >= _prefs.flood_max) return false;
+    if (packet->isRouteFlood() && packet->getPathHashCount() >= _prefs.flood_max) return false;
     return true;
   }
 
@@ -327,12 +351,12 @@ protected:
 
   int calcRxDelay(float score, uint32_t air_time) const override {
     if (_prefs.rx_delay_base <= 0.0f) return 0;
-    return (int) ((pow(_prefs.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+    return calcScoreDelay(_prefs.rx_delay_base, score, air_time);
   }
 
   uint32_t getRetransmitDelay(const mesh::Packet* packet) override {
     uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor);
-    return getRNG()->nextInt(0, 6)*t;
+    return stretchForChannelLoad(getRNG()->nextInt(0, 6)*t);   // spread out more when channel is busy
   }
   uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override {
     uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.direct_tx_delay_factor);
@@ -347,6 +371,12 @@ protected:
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
+  uint8_t getPassiveAckRetries() const override {
+    return _prefs.passive_ack_retries;
+  }
+  float getDirectTxDelayFactor() const override {
+    return _prefs.direct_tx_delay_factor;
+  }
 
   void onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, const mesh::Identity& sender, uint8_t* data, size_t len) override {
     if (packet->getPayloadType() == PAYLOAD_TYPE_ANON_REQ) {  // received an initial request by a possible admin client (unknown at this stage)
@@ -393,10 +423,10 @@ protected:
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
         mesh::Packet* path = createPathReturn(sender, client->secret, packet->path, packet->path_len,
-                                              PAYLOAD_TYPE_RESPONSE, reply_data, 12);
+                                              PAYLOAD_TYPE_RESPONSE, reply_data, 12, packet->getPayloadVer());
         if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
       } else {
-        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, client->secret, reply_data, 12);
+        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, client->secret, reply_data, 12, getReplyVer(client, packet));
         if (reply) {
           if (client->out_path_len >= 0) {  // we have an out_path, so send DIRECT
             sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -410,10 +440,10 @@ protected:
 
   int  matching_peer_indexes[MAX_CLIENTS];
 
-  int searchPeersByHash(const uint8_t* hash) override {
+  int searchPeersByHash(const uint8_t* hash, uint8_t hash_size) override {
     int n = 0;
     for (int i = 0; i < MAX_CLIENTS; i++) {
-      if (known_clients[i].id.isHashMatch(hash)) {
+      if (known_clients[i].id.isHashMatch(hash, hash_size)) {
         matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
       }
     }
@@ -463,10 +493,10 @@ protected:
         if (packet->isRouteFlood()) {
           // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
           mesh::Packet* path = createPathReturn(client->id, secret, packet->path, packet->path_len,
-                                                PAYLOAD_TYPE_RESPONSE, reply_data, reply_len);
+                                                PAYLOAD_TYPE_RESPONSE, reply_data, reply_len, packet->getPayloadVer());
           if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
         } else {
-          mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, secret, reply_data, reply_len);
+          mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, secret, reply_data, reply_len, getReplyVer(client, packet));
           if (reply) {
             if (client->out_path_len >= 0) {  // we have an out_path, so send DIRECT
               sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -497,7 +527,7 @@ protected:
           uint32_t ack_hash;    // calc truncated hash of the message timestamp + text + sender pub_key, to prove to sender that we got it
           mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, 5 + strlen((char *)&data[5]), client->id.pub_key, PUB_KEY_SIZE);
 
-          mesh::Packet* ack = createAck(ack_hash);
+          mesh::Packet* ack = createAck(ack_hash, getReplyVer(client, packet));
           if (ack) {
             if (client->out_path_len < 0) {
               sendFlood(ack, TXT_ACK_DELAY);
@@ -525,7 +555,7 @@ protected:
           memcpy(temp, &timestamp, 4);   // mostly an extra blob to help make packet_hash unique
           temp[4] = (TXT_TYPE_CLI_DATA << 2);   // NOTE: legacy was: TXT_TYPE_PLAIN
 
-          auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, secret, temp, 5 + text_len);
+          auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, secret, temp, 5 + text_len, getReplyVer(client, packet));
           if (reply) {
             if (client->out_path_len < 0) {
               sendFlood(reply, CLI_REPLY_DELAY_MILLIS);
@@ -548,6 +578,7 @@ protected:
       MESH_DEBUG_PRINTLN("PATH to client, path_len=%d", (uint32_t) path_len);
       auto client = &known_clients[i];
       memcpy(client->out_path, path, client->out_path_len = path_len);  // store a copy of path, for sendDirect()
+      client->out_path_ver = packet->getPayloadVer();
     } else {
       MESH_DEBUG_PRINTLN("onPeerPathRecv: invalid peer idx: %d", i);
     }
@@ -587,6 +618,11 @@ public:
     _prefs.advert_interval = 1;  // default to 2 minutes for NEW installs
     _prefs.flood_advert_interval = 3;   // 3 hours
     _prefs.flood_max = 64;
+    _prefs.passive_ack_retries = 0;  // disabled
+    _prefs.tx_weights[TX_CLASS_OWN] = 3;
+    _prefs.tx_weights[TX_CLASS_DIRECT] = 3;
+    _prefs.tx_weights[TX_CLASS_FLOOD] = 2;
+    _prefs.tx_weights[TX_CLASS_ADVERT] = 1;
     _prefs.interference_threshold = 0;  // disabled
   }
 
@@ -601,6 +637,7 @@ public:
 
     updateAdvertTimer();
     updateFloodAdvertTimer();
+    updateTxScheduler();
   }
 
   const char* getFirmwareVer() override { return FIRMWARE_VERSION; }
@@ -615,6 +652,14 @@ public:
     _cli.savePrefs(_fs);
   }
 
+  void updateTxScheduler() override {
+    ((StaticPoolPacketManager *)_mgr)->setTxWeights(_prefs.tx_weights);
+  }
+
+  const uint32_t* getTxDelayHistogram(int tx_class) override {
+    return ((StaticPoolPacketManager *)_mgr)->getTxDelayHistogram(tx_class);
+  }
+
   void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) override {
     set_radio_at = futureMillis(2000);   // give CLI reply some time to be sent back, before applying temp radio params
     pending_freq = freq;
@@ -649,14 +694,14 @@ public:
 
   void updateAdvertTimer() override {
     if (_prefs.advert_interval > 0) {  // schedule local advert timer
-      next_local_advert = futureMillis( ((uint32_t)_prefs.advert_interval) * 2 * 60 * 1000);
+      next_local_advert = futureMillis(stretchForChannelLoad(((uint32_t)_prefs.advert_interval) * 2 * 60 * 1000));   // back-off when channel is busy
     } else {
       next_local_advert = 0;  // stop the timer
     }
   }
   void updateFloodAdvertTimer() override {
     if (_prefs.flood_advert_interval > 0) {  // schedule flood advert timer
-      next_flood_advert = futureMillis( ((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000);
+      next_flood_advert = futureMillis(stretchForChannelLoad(((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000));
     } else {
       next_flood_advert = 0;  // stop the timer
     }
@@ -721,6 +766,7 @@ public:
     radio_driver.resetStats();
     resetStats();
     ((SimpleMeshTables *)getTables())->resetStats();
+    ((StaticPoolPacketManager *)_mgr)->resetStats();
   }
 
   void handleCommand(uint32_t sender_timestamp, char* command, char* reply) {
@@ -735,6 +781,13 @@ public:
     _cli.handleCommand(sender_timestamp, command, reply);  // common CLI commands
   }
 
+  uint32_t getMillisToNextEvent() const override {
+    uint32_t millis = mesh::Mesh::getMillisToNextEvent();
+    unsigned long timers[] = { next_flood_advert, next_local_advert, set_radio_at, revert_radio_at };
+    updateDeadlines(millis, timers, sizeof(timers) / sizeof(timers[0]));
+    return millis;
+  }
+
   void loop() {
     mesh::Mesh::loop();
 
@@ -869,4 +922,9 @@ void loop() {
 
   the_mesh.loop();
   sensors.loop();
+#ifndef DISPLAY_CLASS
+  if (command[0] == 0) {
+    board.sleep(the_mesh.getMillisToNextEvent());   // if board supports it
+  }
+#endif
 }
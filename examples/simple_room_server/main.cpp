@@ -105,6 +105,7 @@ struct ClientInfo {
   uint8_t  secret[PUB_KEY_SIZE];
   int      out_path_len;
   uint8_t  out_path[MAX_PATH_SIZE];
+  uint8_t  out_path_ver;   // PAYLOAD_VER_* of out_path
 };
 
 #define MAX_POST_TEXT_LEN    (160-9)
@@ -148,6 +149,12 @@ struct ServerStats {
   int16_t  last_snr;   // x 4
   uint16_t n_direct_dups, n_flood_dups;
   uint16_t n_posted, n_post_push;
+  uint16_t chan_util;      // percent x 10
+  uint16_t load_stretch;   // x 100
+  uint16_t n_cad_deferrals, n_cad_forced;
+  uint16_t n_stale_tx, n_stale_rx;
+  uint16_t n_queue_drops[QUEUE_DROP_CLASSES];   // outbound packets dropped when pool ran out, by priority class
+  uint16_t n_rx_backlog, n_rx_dropped;   // radio RX ring
 };
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
@@ -192,10 +199,15 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
     }
     newClient->id = id;
     newClient->out_path_len = -1;  // initially out_path is unknown
+    newClient->out_path_ver = PAYLOAD_VER_1;
     newClient->last_timestamp = 0;
     return newClient;
   }
 
+  static uint8_t getReplyVer(const ClientInfo* client, const mesh::Packet* packet) {
+    return client->out_path_len >= 0 ? client->out_path_ver : packet->getPayloadVer();   // must match hash size in out_path
+  }
+
   void  evict(ClientInfo* client) {
     client->last_activity = 0;  // this slot will now be re-used (will be oldest)
     memset(client->id.pub_key, 0, sizeof(client->id.pub_key));
@@ -233,14 +245,16 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
     mesh::Utils::sha256((uint8_t *)&client->pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
     client->push_post_timestamp = post.post_timestamp;
 
-    auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->secret, reply_data, len);
+    uint8_t ver = client->out_path_len >= 0 ? client->out_path_ver : PAYLOAD_VER_1;
+    auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->secret, reply_data, len, ver);
     if (reply) {
       if (client->out_path_len < 0) {
         sendFlood(reply);
         client->ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
       } else {
         sendDirect(reply, client->out_path, client->out_path_len);
-        client->ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (client->out_path_len + 1));
+        int hops = client->out_path_len / mesh::Packet::getPathHashSizeFor(ver);
+        client->ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (hops + 1));
       }
       _num_post_pushes++;  // stats
     } else {
@@ -318,6 +332,18 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
         stats.last_snr = (int16_t)(radio_driver.getLastSNR() * 4);
         stats.n_direct_dups = ((SimpleMeshTables *)getTables())->getNumDirectDups();
         stats.n_flood_dups = ((SimpleMeshTables *)getTables())->getNumFloodDups();
+        stats.chan_util = getChannelUtilisation() * 10;
+        stats.load_stretch = getChannelLoadStretch() * 100;
+        stats.n_cad_deferrals = getNumCADDeferrals();
+        stats.n_cad_forced = getNumCADForced();
+        stats.n_stale_tx = getNumStaleTx();
+        stats.n_stale_rx = getNumStaleRx();
+        {
+          auto mgr = (StaticPoolPacketManager *) _mgr;
+          for (int i = 0; i < QUEUE_DROP_CLASSES; i++) stats.n_queue_drops[i] = mgr->getNumTxDrops(i);
+        }
+        stats.n_rx_backlog = _radio->getRecvBacklog();
+        stats.n_rx_dropped = _radio->getRecvDropped();
         stats.n_posted = _num_posted;
         stats.n_post_push = _num_post_pushes;
 
@@ -404,7 +430,7 @@ protected:
 
   int calcRxDelay(float score, uint32_t air_time) const override {
     if (_prefs.rx_delay_base <= 0.0f) return 0;
-    return (int) ((pow(_prefs.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+    return calcScoreDelay(_prefs.rx_delay_base, score, air_time);
   }
 
   const char* getLogDateTime() override {
@@ -417,7 +443,7 @@ protected:
 
   uint32_t getRetransmitDelay(const mesh::Packet* packet) override {
     uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor);
-    return getRNG()->nextInt(0, 6)*t;
+    return stretchForChannelLoad(getRNG()->nextInt(0, 6)*t);   // spread out more when channel is busy
   }
   uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override {
     uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.direct_tx_delay_factor);
@@ -432,10 +458,16 @@ protected:
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
+  uint8_t getPassiveAckRetries() const override {
+    return _prefs.passive_ack_retries;
+  }
+  float getDirectTxDelayFactor() const override {
+    return _prefs.direct_tx_delay_factor;
+  }
 
   bool allowPacketForward(const mesh::Packet* packet) override {
     if (_prefs.disable_fwd) return false;
-    if (packet->isRouteFlood() && packet->path_len >= _prefs.flood_max) return false;
+    if (packet->isRouteFlood() && packet->getPathHashCount() >= _prefs.flood_max) return false;
     return true;
   }
 
@@ -491,10 +523,10 @@ protected:
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
         mesh::Packet* path = createPathReturn(sender, client->secret, packet->path, packet->path_len,
-                                              PAYLOAD_TYPE_RESPONSE, reply_data, 8 + 2);
+                                              PAYLOAD_TYPE_RESPONSE, reply_data, 8 + 2, packet->getPayloadVer());
         if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
       } else {
-        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, client->secret, reply_data, 8 + 2);
+        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, client->secret, reply_data, 8 + 2, getReplyVer(client, packet));
         if (reply) {
           if (client->out_path_len >= 0) {  // we have an out_path, so send DIRECT
             sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -508,10 +540,10 @@ protected:
 
   int  matching_peer_indexes[MAX_CLIENTS];
 
-  int searchPeersByHash(const uint8_t* hash) override {
+  int searchPeersByHash(const uint8_t* hash, uint8_t hash_size) override {
     int n = 0;
     for (int i = 0; i < num_clients; i++) {
-      if (known_clients[i].id.isHashMatch(hash)) {
+      if (known_clients[i].id.isHashMatch(hash, hash_size)) {
         matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
       }
     }
@@ -587,18 +619,18 @@ protected:
         uint32_t delay_millis;
         if (send_ack) {
           if (client->out_path_len < 0) {
-            mesh::Packet* ack = createAck(ack_hash);
+            mesh::Packet* ack = createAck(ack_hash, getReplyVer(client, packet));
             if (ack) sendFlood(ack, TXT_ACK_DELAY);
             delay_millis = TXT_ACK_DELAY + REPLY_DELAY_MILLIS;
           } else {
             uint32_t d = TXT_ACK_DELAY;
             if (getExtraAckTransmitCount() > 0) {
-              mesh::Packet* a1 = createMultiAck(ack_hash, 1);
+              mesh::Packet* a1 = createMultiAck(ack_hash, 1, getReplyVer(client, packet));
               if (a1) sendDirect(a1, client->out_path, client->out_path_len, d);
               d += 300;
             }
 
-            mesh::Packet* a2 = createAck(ack_hash);
+            mesh::Packet* a2 = createAck(ack_hash, getReplyVer(client, packet));
             if (a2) sendDirect(a2, client->out_path, client->out_path_len, d);
             delay_millis = d + REPLY_DELAY_MILLIS;
           }
@@ -617,7 +649,7 @@ protected:
           // calc expected ACK reply
           //mesh::Utils::sha256((uint8_t *)&expected_ack_crc, 4, temp, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
 
-          auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, secret, temp, 5 + text_len);
+          auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, secret, temp, 5 + text_len, getReplyVer(client, packet));
           if (reply) {
             if (client->out_path_len < 0) {
               sendFlood(reply, delay_millis + SERVER_RESPONSE_DELAY);
@@ -662,7 +694,7 @@ protected:
             uint32_t ack_hash;    // calc ACK to prove to sender that we got request
             mesh::Utils::sha256((uint8_t *) &ack_hash, 4, data, 9, client->id.pub_key, PUB_KEY_SIZE);
 
-            auto reply = createAck(ack_hash);
+            auto reply = createAck(ack_hash, getReplyVer(client, packet));
             if (reply) {
               reply->payload[reply->payload_len++] = getUnsyncedCount(client);  // NEW: add unsynced counter to end of ACK packet
               sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -674,10 +706,10 @@ protected:
             if (packet->isRouteFlood()) {
               // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
               mesh::Packet* path = createPathReturn(client->id, secret, packet->path, packet->path_len,
-                                                    PAYLOAD_TYPE_RESPONSE, reply_data, reply_len);
+                                                    PAYLOAD_TYPE_RESPONSE, reply_data, reply_len, packet->getPayloadVer());
               if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
             } else {
-              mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, secret, reply_data, reply_len);
+              mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, client->id, secret, reply_data, reply_len, getReplyVer(client, packet));
               if (reply) {
                 if (client->out_path_len >= 0) {  // we have an out_path, so send DIRECT
                   sendDirect(reply, client->out_path, client->out_path_len, SERVER_RESPONSE_DELAY);
@@ -700,6 +732,7 @@ protected:
       MESH_DEBUG_PRINTLN("PATH to client, path_len=%d", (uint32_t) path_len);
       auto client = &known_clients[i];
       memcpy(client->out_path, path, client->out_path_len = path_len);  // store a copy of path, for sendDirect()
+      client->out_path_ver = packet->getPayloadVer();
     } else {
       MESH_DEBUG_PRINTLN("onPeerPathRecv: invalid peer idx: %d", i);
     }
@@ -746,6 +779,11 @@ public:
     _prefs.advert_interval = 1;  // default to 2 minutes for NEW installs
     _prefs.flood_advert_interval = 3;   // 3 hours
     _prefs.flood_max = 64;
+    _prefs.passive_ack_retries = 0;  // disabled
+    _prefs.tx_weights[TX_CLASS_OWN] = 3;
+    _prefs.tx_weights[TX_CLASS_DIRECT] = 3;
+    _prefs.tx_weights[TX_CLASS_FLOOD] = 2;
+    _prefs.tx_weights[TX_CLASS_ADVERT] = 1;
     _prefs.interference_threshold = 0;  // disabled 
   #ifdef ROOM_PASSWORD
     StrHelper::strncpy(_prefs.guest_password, ROOM_PASSWORD, sizeof(_prefs.guest_password));
@@ -770,6 +808,7 @@ public:
 
     updateAdvertTimer();
     updateFloodAdvertTimer();
+    updateTxScheduler();
   }
 
   const char* getFirmwareVer() override { return FIRMWARE_VERSION; }
@@ -784,6 +823,14 @@ public:
     _cli.savePrefs(_fs);
   }
 
+  void updateTxScheduler() override {
+    ((StaticPoolPacketManager *)_mgr)->setTxWeights(_prefs.tx_weights);
+  }
+
+  const uint32_t* getTxDelayHistogram(int tx_class) override {
+    return ((StaticPoolPacketManager *)_mgr)->getTxDelayHistogram(tx_class);
+  }
+
   void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) override {
     set_radio_at = futureMillis(2000);   // give CLI reply some time to be sent back, before applying temp radio params
     pending_freq = freq;
@@ -818,14 +865,14 @@ public:
 
   void updateAdvertTimer() override {
     if (_prefs.advert_interval > 0) {  // schedule local advert timer
-      next_local_advert = futureMillis((uint32_t)_prefs.advert_interval * 2 * 60 * 1000);
+      next_local_advert = futureMillis(stretchForChannelLoad((uint32_t)_prefs.advert_interval * 2 * 60 * 1000));   // back-off when channel is busy
     } else {
       next_local_advert = 0;  // stop the timer
     }
   }
   void updateFloodAdvertTimer() override {
     if (_prefs.flood_advert_interval > 0) {  // schedule flood advert timer
-      next_flood_advert = futureMillis( ((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000);
+      next_flood_advert = futureMillis(stretchForChannelLoad(((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000));
     } else {
       next_flood_advert = 0;  // stop the timer
     }
@@ -867,6 +914,7 @@ public:
     radio_driver.resetStats();
     resetStats();
     ((SimpleMeshTables *)getTables())->resetStats();
+    ((StaticPoolPacketManager *)_mgr)->resetStats();
   }
 
   void handleCommand(uint32_t sender_timestamp, char* command, char* reply) {
@@ -100,14 +100,13 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
         while (!full) {
           ContactInfo c;
           uint8_t pub_key[32];
-          uint8_t unused;
           uint32_t reserved;
 
           bool success = (file.read(pub_key, 32) == 32);
           success = success && (file.read((uint8_t *) &c.name, 32) == 32);
           success = success && (file.read(&c.type, 1) == 1);
           success = success && (file.read(&c.flags, 1) == 1);
-          success = success && (file.read(&unused, 1) == 1);
+          success = success && (file.read(&c.out_path_ver, 1) == 1);   // was 'unused'
           success = success && (file.read((uint8_t *) &reserved, 4) == 4);
           success = success && (file.read((uint8_t *) &c.out_path_len, 1) == 1);
           success = success && (file.read((uint8_t *) &c.last_advert_timestamp, 4) == 4);
@@ -118,6 +117,8 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
 
           c.id = mesh::Identity(pub_key);
           c.lastmod = 0;
+          c.payload_ver = PAYLOAD_VER_1;   // until we hear their next advert
+          c.adv_feat1 = 0;
           if (!addContact(c)) full = true;
         }
         file.close();
@@ -137,7 +138,6 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
     if (file) {
       ContactsIterator iter;
       ContactInfo c;
-      uint8_t unused = 0;
       uint32_t reserved = 0;
 
       while (iter.hasNext(this, c)) {
@@ -145,7 +145,7 @@ class MyMesh : public BaseChatMesh, ContactVisitor {
         success = success && (file.write((uint8_t *) &c.name, 32) == 32);
         success = success && (file.write(&c.type, 1) == 1);
         success = success && (file.write(&c.flags, 1) == 1);
-        success = success && (file.write(&unused, 1) == 1);
+        success = success && (file.write(&c.out_path_ver, 1) == 1);
         success = success && (file.write((uint8_t *) &reserved, 4) == 4);
         success = success && (file.write((uint8_t *) &c.out_path_len, 1) == 1);
         success = success && (file.write((uint8_t *) &c.last_advert_timestamp, 4) == 4);
@@ -99,7 +99,8 @@ void SensorMesh::loadContacts() {
 
         bool success = (file.read(pub_key, 32) == 32);
         success = success && (file.read((uint8_t *) &c.permissions, 1) == 1);
-        success = success && (file.read(unused, 6) == 6);
+        success = success && (file.read(&c.out_path_ver, 1) == 1);
+        success = success && (file.read(unused, 5) == 5);
         success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
         success = success && (file.read(c.out_path, 64) == 64);
         success = success && (file.read(c.shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
@@ -132,7 +133,8 @@ void SensorMesh::saveContacts() {
 
       bool success = (file.write(c->id.pub_key, 32) == 32);
       success = success && (file.write((uint8_t *) &c->permissions, 1) == 1);
-      success = success && (file.write(unused, 6) == 6);
+      success = success && (file.write(&c->out_path_ver, 1) == 1);
+      success = success && (file.write(unused, 5) == 5);
       success = success && (file.write((uint8_t *)&c->out_path_len, 1) == 1);
       success = success && (file.write(c->out_path, 64) == 64);
       success = success && (file.write(c->shared_secret, PUB_KEY_SIZE) == PUB_KEY_SIZE);
@@ -344,6 +346,7 @@ ContactInfo* SensorMesh::putContact(const mesh::Identity& id, uint8_t init_perms
   c->permissions = init_perms;
   c->id = id;
   c->out_path_len = -1;  // initially out_path is unknown
+  c->out_path_ver = PAYLOAD_VER_1;
   return c;
 }
 
@@ -384,7 +387,8 @@ void SensorMesh::sendAlert(ContactInfo* c, Trigger* t) {
   mesh::Utils::sha256((uint8_t *)&t->expected_acks[t->attempt], 4, data, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
   t->attempt++;
 
-  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, c->id, c->shared_secret, data, 5 + text_len);
+  uint8_t ver = c->out_path_len >= 0 ? c->out_path_ver : PAYLOAD_VER_1;
+  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, c->id, c->shared_secret, data, 5 + text_len, ver);
   if (pkt) {
     if (c->out_path_len >= 0) {  // we have an out_path, so send DIRECT
       sendDirect(pkt, c->out_path, c->out_path_len);
@@ -430,18 +434,18 @@ float SensorMesh::getAirtimeBudgetFactor() const {
 
 bool SensorMesh::allowPacketForward(const mesh::Packet* packet) {
   if (_prefs.disable_fwd) return false;
-  if (packet->isRouteFlood() && packet->path_len >= _prefs.flood_max) return false;
+  if (packet->isRouteFlood() && packet->getPathHashCount() >= _prefs.flood_max) return false;
   return true;
 }
 
 int SensorMesh::calcRxDelay(float score, uint32_t air_time) const {
   if (_prefs.rx_delay_base <= 0.0f) return 0;
-  return (int) ((pow(_prefs.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+  return calcScoreDelay(_prefs.rx_delay_base, score, air_time);
 }
 
 uint32_t SensorMesh::getRetransmitDelay(const mesh::Packet* packet) {
   uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor);
-  return getRNG()->nextInt(0, 6)*t;
+  return stretchForChannelLoad(getRNG()->nextInt(0, 6)*t);   // spread out more when channel is busy
 }
 uint32_t SensorMesh::getDirectRetransmitDelay(const mesh::Packet* packet) {
   uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.direct_tx_delay_factor);
@@ -453,6 +457,12 @@ int SensorMesh::getInterferenceThreshold() const {
 int SensorMesh::getAGCResetInterval() const {
   return ((int)_prefs.agc_reset_interval) * 4000;   // milliseconds
 }
+uint8_t SensorMesh::getPassiveAckRetries() const {
+  return _prefs.passive_ack_retries;
+}
+float SensorMesh::getDirectTxDelayFactor() const {
+  return _prefs.direct_tx_delay_factor;
+}
 
 uint8_t SensorMesh::handleLoginReq(const mesh::Identity& sender, const uint8_t* secret, uint32_t sender_timestamp, const uint8_t* data) {
   ContactInfo* client;
@@ -563,19 +573,19 @@ void SensorMesh::onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, con
     if (packet->isRouteFlood()) {
       // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
       mesh::Packet* path = createPathReturn(sender, secret, packet->path, packet->path_len,
-                                            PAYLOAD_TYPE_RESPONSE, reply_data, reply_len);
+                                            PAYLOAD_TYPE_RESPONSE, reply_data, reply_len, packet->getPayloadVer());
       if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
     } else {
-      mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, secret, reply_data, reply_len);
+      mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, sender, secret, reply_data, reply_len, packet->getPayloadVer());
       if (reply) sendFlood(reply, SERVER_RESPONSE_DELAY);
     }
   }
 }
 
-int SensorMesh::searchPeersByHash(const uint8_t* hash) {
+int SensorMesh::searchPeersByHash(const uint8_t* hash, uint8_t hash_size) {
   int n = 0;
   for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
+    if (contacts[i].id.isHashMatch(hash, hash_size)) {
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
   }
@@ -600,6 +610,7 @@ void SensorMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_i
   }
 
   ContactInfo& from = contacts[i];
+  uint8_t reply_ver = from.out_path_len >= 0 ? from.out_path_ver : packet->getPayloadVer();   // must match hash size in out_path
 
   if (type == PAYLOAD_TYPE_REQ) {  // request (from a known contact)
     uint32_t timestamp;
@@ -615,10 +626,10 @@ void SensorMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_i
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
         mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
-                                              PAYLOAD_TYPE_RESPONSE, reply_data, reply_len);
+                                              PAYLOAD_TYPE_RESPONSE, reply_data, reply_len, packet->getPayloadVer());
         if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
       } else {
-        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, from.id, secret, reply_data, reply_len);
+        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, from.id, secret, reply_data, reply_len, reply_ver);
         if (reply) {
           if (from.out_path_len >= 0) {  // we have an out_path, so send DIRECT
             sendDirect(reply, from.out_path, from.out_path_len, SERVER_RESPONSE_DELAY);
@@ -659,7 +670,7 @@ void SensorMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_i
         memcpy(temp, &timestamp, 4);   // mostly an extra blob to help make packet_hash unique
         temp[4] = (TXT_TYPE_CLI_DATA << 2);
 
-        auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, from.id, secret, temp, 5 + text_len);
+        auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, from.id, secret, temp, 5 + text_len, reply_ver);
         if (reply) {
           if (from.out_path_len < 0) {
             sendFlood(reply, CLI_REPLY_DELAY_MILLIS);
@@ -687,6 +698,7 @@ bool SensorMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint
   // NOTE: for this impl, we just replace the current 'out_path' regardless, whenever sender sends us a new out_path.
   // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
   memcpy(from.out_path, path, from.out_path_len = path_len);  // store a copy of path, for sendDirect()
+  from.out_path_ver = packet->getPayloadVer();
   from.last_activity = getRTCClock()->getCurrentTime();
 
   // REVISIT: maybe make ALL out_paths non-persisted to minimise flash writes??
@@ -742,6 +754,7 @@ SensorMesh::SensorMesh(mesh::MainBoard& board, mesh::Radio& radio, mesh::Millise
   _prefs.flood_advert_interval = 0;   // disabled
   _prefs.disable_fwd = true;
   _prefs.flood_max = 64;
+  _prefs.passive_ack_retries = 0;  // disabled
   _prefs.interference_threshold = 0;  // disabled
 }
 
@@ -758,6 +771,7 @@ void SensorMesh::begin(FILESYSTEM* fs) {
 
   updateAdvertTimer();
   updateFloodAdvertTimer();
+  updateTxScheduler();
 }
 
 bool SensorMesh::formatFileSystem() {
@@ -773,6 +787,10 @@ bool SensorMesh::formatFileSystem() {
 #endif
 }
 
+void SensorMesh::updateTxScheduler() {
+  ((StaticPoolPacketManager *)_mgr)->setTxWeights(_prefs.tx_weights);
+}
+
 void SensorMesh::applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) {
   set_radio_at = futureMillis(2000);   // give CLI reply some time to be sent back, before applying temp radio params
   pending_freq = freq;
@@ -794,14 +812,14 @@ void SensorMesh::sendSelfAdvertisement(int delay_millis) {
 
 void SensorMesh::updateAdvertTimer() {
   if (_prefs.advert_interval > 0) {  // schedule local advert timer
-    next_local_advert = futureMillis( ((uint32_t)_prefs.advert_interval) * 2 * 60 * 1000);
+    next_local_advert = futureMillis(stretchForChannelLoad(((uint32_t)_prefs.advert_interval) * 2 * 60 * 1000));   // back-off when channel is busy
   } else {
     next_local_advert = 0;  // stop the timer
   }
 }
 void SensorMesh::updateFloodAdvertTimer() {
   if (_prefs.flood_advert_interval > 0) {  // schedule flood advert timer
-    next_flood_advert = futureMillis( ((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000);
+    next_flood_advert = futureMillis(stretchForChannelLoad(((uint32_t)_prefs.flood_advert_interval) * 60 * 60 * 1000));
   } else {
     next_flood_advert = 0;  // stop the timer
   }
@@ -842,6 +860,20 @@ bool  SensorMesh::getGPS(uint8_t channel, float& lat, float& lon, float& alt) {
   return false;
 }
 
+uint32_t SensorMesh::getMillisToNextEvent() const {
+  uint32_t millis = mesh::Mesh::getMillisToNextEvent();
+  unsigned long timers[] = { next_flood_advert, next_local_advert, set_radio_at, revert_radio_at, dirty_contacts_expiry,
+                             num_alert_tasks > 0 ? alert_tasks[0]->send_expiry : 0 };
+  updateDeadlines(millis, timers, sizeof(timers) / sizeof(timers[0]));
+
+  uint32_t curr = getRTCClock()->getCurrentTime();
+  uint32_t secs = curr >= last_read_time + SENSOR_READ_INTERVAL_SECS ? 0 : last_read_time + SENSOR_READ_INTERVAL_SECS - curr;
+  if (secs > SENSOR_READ_INTERVAL_SECS) secs = SENSOR_READ_INTERVAL_SECS;   // RTC was set backwards
+  if (secs * 1000 < millis) millis = secs * 1000;
+
+  return millis;
+}
+
 void SensorMesh::loop() {
   mesh::Mesh::loop();
 
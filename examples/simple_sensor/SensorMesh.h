@@ -41,6 +41,7 @@ struct ContactInfo {
   uint8_t permissions;
   int8_t out_path_len;
   uint8_t out_path[MAX_PATH_SIZE];
+  uint8_t out_path_ver;      // PAYLOAD_VER_* of out_path
   uint8_t shared_secret[PUB_KEY_SIZE];
   uint32_t last_timestamp;   // by THEIR clock  (transient)
   uint32_t last_activity;    // by OUR clock    (transient)
@@ -68,6 +69,7 @@ public:
   SensorMesh(mesh::MainBoard& board, mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::MeshTables& tables);
   void begin(FILESYSTEM* fs);
   void loop();
+  uint32_t getMillisToNextEvent() const override;
   void handleCommand(uint32_t sender_timestamp, char* command, char* reply);
 
   // CommonCLI callbacks
@@ -91,6 +93,10 @@ public:
   const uint8_t* getSelfIdPubKey() override { return self_id.pub_key; }
   void clearStats() override { }
   void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) override;
+  void updateTxScheduler() override;
+  const uint32_t* getTxDelayHistogram(int tx_class) override {
+    return ((StaticPoolPacketManager *)_mgr)->getTxDelayHistogram(tx_class);
+  }
 
   float getTelemValue(uint8_t channel, uint8_t type);
 
@@ -134,8 +140,10 @@ protected:
   uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override;
   int getInterferenceThreshold() const override;
   int getAGCResetInterval() const override;
+  uint8_t getPassiveAckRetries() const override;
+  float getDirectTxDelayFactor() const override;
   void onAnonDataRecv(mesh::Packet* packet, const uint8_t* secret, const mesh::Identity& sender, uint8_t* data, size_t len) override;
-  int searchPeersByHash(const uint8_t* hash) override;
+  int searchPeersByHash(const uint8_t* hash, uint8_t hash_size) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
   bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
@@ -143,5 +143,9 @@ void loop() {
   sensors.loop();
 #ifdef DISPLAY_CLASS
   ui_task.loop();
+#else
+  if (command[0] == 0) {
+    board.sleep(the_mesh.getMillisToNextEvent());   // if board supports it
+  }
 #endif
 }
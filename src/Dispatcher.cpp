@@ -14,11 +14,40 @@ namespace mesh {
   #define NOISE_FLOOR_CALIB_INTERVAL   2000     // 2 seconds
 #endif
 
+#define STALE_SWEEP_INTERVAL   1000
+
+#if MESH_PACKET_LOGGING
+static void logSrcDest(const Packet* pkt) {   // ends the log line, with [src -> dest] hashes if payload has them
+  int hs = pkt->getPathHashSize();
+  if ((pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ
+      || pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG)
+      && pkt->payload_len >= 2*hs) {
+    Serial.print(" [");
+    Utils::printHex(Serial, &pkt->payload[hs], hs);
+    Serial.print(" -> ");
+    Utils::printHex(Serial, pkt->payload, hs);
+    Serial.print("]");
+  }
+  Serial.printf("\n");
+}
+#endif
+
+#ifndef CHAN_UTIL_LOW_PCT
+  #define CHAN_UTIL_LOW_PCT     25     // below this, no stretching of background traffic
+#endif
+#ifndef CHAN_UTIL_HIGH_PCT
+  #define CHAN_UTIL_HIGH_PCT    75     // at or above this, max stretch
+#endif
+#ifndef CHAN_LOAD_MAX_STRETCH
+  #define CHAN_LOAD_MAX_STRETCH  4.0f
+#endif
+
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
   _err_flags = 0;
   radio_nonrx_start = _ms->getMillis();
+  busy_bucket_start = _ms->getMillis();
 
   _radio->begin();
   prev_isrecv_mode = _radio->isInRecvMode();
@@ -29,7 +58,54 @@ float Dispatcher::getAirtimeBudgetFactor() const {
 }
 
 int Dispatcher::calcRxDelay(float score, uint32_t air_time) const {
-  return (int) ((pow(10, 0.85f - score) - 1.0) * air_time);
+  return calcScoreDelay(10.0f, score, air_time);
+}
+
+int Dispatcher::calcScoreDelay(float base, float score, uint32_t air_time) const {
+  if (base != rx_delay_base) {   // rebuild table, so no pow() per received packet
+    for (int i = 0; i <= RX_DELAY_SCORE_STEPS; i++) {
+      rx_delay_factor[i] = pow(base, 0.85f - (float)i / RX_DELAY_SCORE_STEPS) - 1.0f;
+    }
+    rx_delay_base = base;
+  }
+  if (score <= 0.0f) return (int) (rx_delay_factor[0] * air_time);
+  if (score >= 1.0f) return (int) (rx_delay_factor[RX_DELAY_SCORE_STEPS] * air_time);
+
+  float pos = score * RX_DELAY_SCORE_STEPS;
+  int i = (int) pos;
+  float f = rx_delay_factor[i] + (rx_delay_factor[i + 1] - rx_delay_factor[i]) * (pos - i);
+  return (int) (f * air_time);
+}
+
+float Dispatcher::getChannelLoadStretch() const {
+  float util = getChannelUtilisation();
+  if (util <= CHAN_UTIL_LOW_PCT) return 1.0f;
+  if (util >= CHAN_UTIL_HIGH_PCT) return CHAN_LOAD_MAX_STRETCH;
+  return 1.0f + (CHAN_LOAD_MAX_STRETCH - 1.0f) * (util - CHAN_UTIL_LOW_PCT) / (CHAN_UTIL_HIGH_PCT - CHAN_UTIL_LOW_PCT);
+}
+
+float Dispatcher::getChannelUtilisation() const {
+  uint32_t busy = 0;
+  for (int i = 0; i < CHAN_UTIL_NUM_BUCKETS; i++) {
+    // NOTE: CAD busy is mostly the same frames we receive, but also catches ones we can't decode
+    busy += busy_tx[i] + (busy_cad[i] > busy_rx[i] ? busy_cad[i] : busy_rx[i]);
+  }
+  uint32_t window = (CHAN_UTIL_NUM_BUCKETS - 1)*CHAN_UTIL_BUCKET_MILLIS + (_ms->getMillis() - busy_bucket_start);
+  if (busy >= window) return 100.0f;
+  return busy * 100.0f / window;
+}
+
+void Dispatcher::rollBusyBuckets() {
+  int n = 0;
+  while (_ms->getMillis() - busy_bucket_start >= CHAN_UTIL_BUCKET_MILLIS) {
+    if (++n > CHAN_UTIL_NUM_BUCKETS) {   // long gap, all buckets now stale
+      busy_bucket_start = _ms->getMillis();
+      break;
+    }
+    busy_idx = (busy_idx + 1) % CHAN_UTIL_NUM_BUCKETS;
+    busy_rx[busy_idx] = busy_tx[busy_idx] = busy_cad[busy_idx] = 0;
+    busy_bucket_start += CHAN_UTIL_BUCKET_MILLIS;
+  }
 }
 
 uint32_t Dispatcher::getCADFailRetryDelay() const {
@@ -38,6 +114,9 @@ uint32_t Dispatcher::getCADFailRetryDelay() const {
 uint32_t Dispatcher::getCADFailMaxDuration() const {
   return 4000;   // 4 seconds
 }
+uint32_t Dispatcher::getCADBackoffDelay(uint8_t attempt) const {
+  return getCADFailRetryDelay();   // by default, no back-off
+}
 
 void Dispatcher::loop() {
   if (millisHasNowPassed(next_floor_calib_time)) {
@@ -45,6 +124,7 @@ void Dispatcher::loop() {
     next_floor_calib_time = futureMillis(NOISE_FLOOR_CALIB_INTERVAL);
   }
   _radio->loop();
+  rollBusyBuckets();
 
   // check for radio 'stuck' in mode other than Rx
   bool is_recv = _radio->isInRecvMode();
@@ -62,6 +142,7 @@ void Dispatcher::loop() {
     if (_radio->isSendComplete()) {
       long t = _ms->getMillis() - outbound_start;
       total_air_time += t;  // keep track of how much air time we are using
+      busy_tx[busy_idx] += t;
       //Serial.print("  airtime="); Serial.println(t);
 
       // will need radio silence up to next_tx_time
@@ -78,6 +159,7 @@ void Dispatcher::loop() {
       outbound = NULL;
     } else if (millisHasNowPassed(outbound_expiry)) {
       MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): WARNING: outbound packed send timed out!", getLogDateTime());
+      busy_tx[busy_idx] += _ms->getMillis() - outbound_start;
 
       _radio->onSendFinished();
       logTxFail(outbound, 2 + outbound->path_len + outbound->payload_len);
@@ -101,9 +183,19 @@ void Dispatcher::loop() {
   {
     Packet* pkt = _mgr->getNextInbound(_ms->getMillis());
     if (pkt) {
-      processRecvPacket(pkt);
+      if (isStale(pkt)) {   // too late to be worth forwarding, but may still be for us
+        MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): stale inbound packet, not forwarding", getLogDateTime());
+        n_stale_rx++;
+        processRecvPacket(pkt, false);
+      } else {
+        processRecvPacket(pkt);
+      }
     }
   }
+  if (millisHasNowPassed(next_stale_sweep)) {
+    sweepStaleOutbound();   // so pool slots are freed sooner
+    next_stale_sweep = futureMillis(STALE_SWEEP_INTERVAL);
+  }
   checkRecv();
   checkSend();
 }
@@ -117,12 +209,14 @@ void Dispatcher::checkRecv() {
     int len = _radio->recvRaw(raw, MAX_TRANS_UNIT);
     if (len > 0) {
       logRxRaw(_radio->getLastSNR(), _radio->getLastRSSI(), raw, len);
+      busy_rx[busy_idx] += _radio->getEstAirtimeFor(len);
 
       pkt = _mgr->allocNew();
       if (pkt == NULL) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): WARNING: received data, no unused packets available!", getLogDateTime());
       } else {
         int i = 0;
+        pkt->_is_local = false;
 #ifdef NODE_ID
         uint8_t sender_id = raw[i++];
         if (sender_id == NODE_ID - 1 || sender_id == NODE_ID + 1) {  // simulate that NODE_ID can only hear NODE_ID-1 or NODE_ID+1, eg. 3 can't hear 1
@@ -178,12 +272,7 @@ void Dispatcher::checkRecv() {
     Serial.print(" hash=");
     mesh::Utils::printHex(Serial, packet_hash, MAX_HASH_SIZE);
 
-    if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ
-        || pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-      Serial.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-    } else {
-      Serial.printf("\n");
-    }
+    logSrcDest(pkt);
     #endif
     logRx(pkt, pkt->getRawLength(), score);   // hook for custom logging
 
@@ -199,7 +288,8 @@ void Dispatcher::checkRecv() {
         if (_delay > MAX_RX_DELAY_MILLIS) {
           _delay = MAX_RX_DELAY_MILLIS;
         }
-        _mgr->queueInbound(pkt, futureMillis(_delay)); // add to delayed inbound queue
+        pkt->_due_at = futureMillis(_delay);
+        _mgr->queueInbound(pkt, pkt->_due_at); // add to delayed inbound queue
       }
     } else {
       n_recv_direct++;
@@ -208,9 +298,9 @@ void Dispatcher::checkRecv() {
   }
 }
 
-void Dispatcher::processRecvPacket(Packet* pkt) {
+void Dispatcher::processRecvPacket(Packet* pkt, bool allow_retransmit) {
   DispatcherAction action = onRecvPacket(pkt);
-  if (action == ACTION_RELEASE) {
+  if (action == ACTION_RELEASE || (!allow_retransmit && action != ACTION_MANUAL_HOLD)) {
     _mgr->free(pkt);
   } else if (action == ACTION_MANUAL_HOLD) {
     // sub-class is wanting to manually hold Packet instance, and call releasePacket() at appropriate time
@@ -218,7 +308,8 @@ void Dispatcher::processRecvPacket(Packet* pkt) {
     uint8_t priority = (action >> 24) - 1;
     uint32_t _delay = action & 0xFFFFFF;
 
-    _mgr->queueOutbound(pkt, priority, futureMillis(_delay));
+    pkt->_due_at = futureMillis(_delay);
+    _mgr->queueOutbound(pkt, priority, pkt->_due_at);
   }
 }
 
@@ -232,18 +323,44 @@ void Dispatcher::checkSend() {
 
     if (_ms->getMillis() - cad_busy_start > getCADFailMaxDuration()) {
       _err_flags |= ERR_EVENT_CAD_TIMEOUT;
+      n_cad_forced++;
 
       MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): CAD busy max duration reached!", getLogDateTime());
       // channel activity has gone on too long... (Radio might be in a bad state)
       // force the pending transmit below...
     } else {
-      next_tx_time = futureMillis(getCADFailRetryDelay());
+      if (cad_attempts < 0xFF) cad_attempts++;
+      n_cad_deferrals++;
+      next_tx_time = futureMillis(getCADBackoffDelay(cad_attempts));   // back-off, so backlogged nodes don't retry in lock-step
       return;
     }
+  } else {
+    if (cad_busy_start) {
+      busy_cad[busy_idx] += _ms->getMillis() - cad_busy_start;
+      cad_busy_start = 0;
+    }
+    if (cad_attempts > 0) {   // channel now clear, after being busy (others are likely waiting for it too)
+      int pri = _mgr->getNextOutboundPriority(_ms->getMillis());
+      if (pri >= 0 && !allowSendAfterBusy(pri)) {   // p-persistence
+        if (cad_attempts < 0xFF) cad_attempts++;
+        n_cad_deferrals++;
+        next_tx_time = futureMillis(getCADBackoffDelay(0));   // sense again after one slot
+        return;
+      }
+    }
+  }
+  if (cad_busy_start) {   // forced
+    busy_cad[busy_idx] += _ms->getMillis() - cad_busy_start;
   }
   cad_busy_start = 0;  // reset busy state
+  last_cad_deferrals = cad_attempts;
+  cad_attempts = 0;
 
-  outbound = _mgr->getNextOutbound(_ms->getMillis());
+  while ((outbound = _mgr->getNextOutbound(_ms->getMillis())) != NULL && isStale(outbound)) {
+    MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): discarding stale outbound packet", getLogDateTime());
+    n_stale_tx++;
+    releasePacket(outbound);
+  }
   if (outbound) {
     int len = 0;
     uint8_t raw[MAX_TRANS_UNIT];
@@ -284,24 +401,45 @@ void Dispatcher::checkSend() {
       Serial.print(getLogDateTime());
       Serial.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", 
             len, outbound->getPayloadType(), outbound->isRouteDirect() ? "D" : "F", outbound->payload_len);
-      if (outbound->getPayloadType() == PAYLOAD_TYPE_PATH || outbound->getPayloadType() == PAYLOAD_TYPE_REQ
-        || outbound->getPayloadType() == PAYLOAD_TYPE_RESPONSE || outbound->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        Serial.printf(" [%02X -> %02X]\n", (uint32_t)outbound->payload[1], (uint32_t)outbound->payload[0]);
-      } else {
-        Serial.printf("\n");
-      }
+      logSrcDest(outbound);
     #endif
     }
   }
 }
 
-Packet* Dispatcher::obtainNewPacket() {
+bool Dispatcher::isStale(const Packet* pkt) const {
+  uint32_t max_age = getMaxQueueAge(pkt);
+  return max_age > 0 && (long)(_ms->getMillis() - pkt->_due_at) > (long)max_age;
+}
+
+void Dispatcher::sweepStaleOutbound() {
+  int i = 0;
+  while (i < _mgr->getOutboundCount(0xFFFFFFFF)) {
+    Packet* pkt = _mgr->getOutboundByIdx(i);
+    if (isStale(pkt)) {
+      n_stale_tx++;
+      releasePacket(_mgr->removeOutboundByIdx(i));
+    } else {
+      i++;
+    }
+  }
+}
+
+int OutboundScheduler::classifyPacket(const Packet* packet) {
+  if (packet->getPayloadType() == PAYLOAD_TYPE_ADVERT) return TX_CLASS_ADVERT;
+  if (packet->_is_local) return TX_CLASS_OWN;
+  return packet->isRouteDirect() ? TX_CLASS_DIRECT : TX_CLASS_FLOOD;
+}
+
+Packet* Dispatcher::obtainNewPacket(uint8_t priority) {
   auto pkt = _mgr->allocNew();  // TODO: zero out all fields
+  if (pkt == NULL && priority < 0xFF) pkt = _mgr->reclaimOutbound(priority);
   if (pkt == NULL) {
     _err_flags |= ERR_EVENT_FULL;
   } else {
     pkt->payload_len = pkt->path_len = 0;
     pkt->_snr = 0;
+    pkt->_is_local = true;
   }
   return pkt;
 }
@@ -315,10 +453,33 @@ void Dispatcher::sendPacket(Packet* packet, uint8_t priority, uint32_t delay_mil
     MESH_DEBUG_PRINTLN("%s Dispatcher::sendPacket(): ERROR: invalid packet... path_len=%d, payload_len=%d", getLogDateTime(), (uint32_t) packet->path_len, (uint32_t) packet->payload_len);
     _mgr->free(packet);
   } else {
-    _mgr->queueOutbound(packet, priority, futureMillis(delay_millis));
+    packet->_due_at = futureMillis(delay_millis);
+    _mgr->queueOutbound(packet, priority, packet->_due_at);
   }
 }
 
+uint32_t Dispatcher::getMillisToNextEvent() const {
+  if (_radio->hasPendingWork()) return 0;
+
+  uint32_t millis = 0xFFFFFFFF;
+  updateDeadline(millis, next_floor_calib_time);
+  if (outbound) {   // nothing else can happen until send completes (radio IRQ)
+    updateDeadline(millis, outbound_expiry);
+    return millis;
+  }
+  if (getAGCResetInterval() > 0) updateDeadline(millis, next_agc_reset_time);
+
+  uint32_t t = _mgr->getNextInboundTime();
+  if (t != 0xFFFFFFFF) updateDeadline(millis, t);
+
+  t = _mgr->getNextOutboundTime();
+  if (t != 0xFFFFFFFF) {
+    updateDeadline(millis, (long)(next_tx_time - t) > 0 ? next_tx_time : t);   // whichever is later
+    updateDeadline(millis, next_stale_sweep);
+  }
+  return millis;
+}
+
 // Utility function -- handles the case where millis() wraps around back to zero
 //   2's complement arithmetic will handle any unsigned subtraction up to HALF the word size (32-bits in this case)
 bool Dispatcher::millisHasNowPassed(unsigned long timestamp) const {
@@ -329,4 +490,16 @@ unsigned long Dispatcher::futureMillis(int millis_from_now) const {
   return _ms->getMillis() + millis_from_now;
 }
 
+void Dispatcher::updateDeadline(uint32_t& millis, unsigned long timestamp) const {
+  long d = (long)(timestamp - _ms->getMillis());
+  if (d < 0) d = 0;
+  if ((uint32_t)d < millis) millis = d;
+}
+
+void Dispatcher::updateDeadlines(uint32_t& millis, const unsigned long timers[], int num) const {
+  for (int i = 0; i < num; i++) {
+    if (timers[i]) updateDeadline(millis, timers[i]);   // zero means timer not set
+  }
+}
+
 }
\ No newline at end of file
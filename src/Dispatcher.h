@@ -61,6 +61,14 @@ public:
    */
   virtual void loop() { }
 
+  /**
+   * \returns  true if loop() needs to be called again straight away (ie. not waiting on a timer or radio IRQ)
+   */
+  virtual bool hasPendingWork() { return true; }
+
+  virtual uint32_t getRecvBacklog() const { return 0; }   // frames received while previous was still unread
+  virtual uint32_t getRecvDropped() const { return 0; }   // frames lost (eg. receive buffer full)
+
   virtual int getNoiseFloor() const { return 0; }
 
   virtual void triggerNoiseFloorCalibrate(int threshold) { }
@@ -78,6 +86,32 @@ public:
   virtual float getLastSNR() const { return 0; }
 };
 
+#define TX_CLASS_OWN      0   // originated by this node
+#define TX_CLASS_DIRECT   1   // forwarding direct (routed) packets
+#define TX_CLASS_FLOOD    2   // forwarding flood packets
+#define TX_CLASS_ADVERT   3   // adverts, ours or forwarded
+#define TX_NUM_CLASSES    4
+
+#define TX_DELAY_BUCKETS  8   // queueing delay histogram: <32ms, <64, <128 ... <2048, 2048+
+
+/**
+ * \brief  Decides which traffic class gets to transmit next, when more than one has packets waiting.
+ *         Within a class, packets still go by priority.
+*/
+class OutboundScheduler {
+public:
+  static int classifyPacket(const Packet* packet);   // default classification, returns TX_CLASS_*
+
+  virtual int classify(const Packet* packet) const { return classifyPacket(packet); }
+
+  /**
+   * \param  head_len  per class, the raw length of the packet which would be sent next, or zero if class has none due
+   * \param  peek  true if just querying, ie. internal state must not be updated
+   * \returns  the TX_CLASS_* to send from next (must be one with head_len > 0)
+   */
+  virtual int selectClass(const int head_len[], bool peek) = 0;
+};
+
 /**
  * \brief  An abstraction for managing instances of Packets (eg. in a static pool),
  *        and for managing the outbound packet queue.
@@ -85,16 +119,21 @@ public:
 class PacketManager {
 public:
   virtual Packet* allocNew() = 0;
+  virtual Packet* reclaimOutbound(uint8_t priority) { return NULL; }   // removes a queued packet LESS important than 'priority', for reuse
   virtual void free(Packet* packet) = 0;
 
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
+  virtual int getNextOutboundPriority(uint32_t now) const = 0;   // of what getNextOutbound() would return, or -1 if none
   virtual int getOutboundCount(uint32_t now) const = 0;
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
   virtual Packet* removeOutboundByIdx(int i) = 0;
   virtual void queueInbound(Packet* packet, uint32_t scheduled_for) = 0;
   virtual Packet* getNextInbound(uint32_t now) = 0;
+  virtual uint32_t getNextOutboundTime() const = 0;   // earliest scheduled_for, or 0xFFFFFFFF if queue is empty
+  virtual uint32_t getNextInboundTime() const = 0;
+  virtual void setScheduler(OutboundScheduler* sched) = 0;   // NULL for strict priority
 };
 
 typedef uint32_t  DispatcherAction;
@@ -104,6 +143,17 @@ typedef uint32_t  DispatcherAction;
 #define ACTION_RETRANSMIT(pri)   (((uint32_t)1 + (pri))<<24)
 #define ACTION_RETRANSMIT_DELAYED(pri, _delay)  ((((uint32_t)1 + (pri))<<24) | (_delay))
 
+#ifndef CHAN_UTIL_NUM_BUCKETS
+  #define CHAN_UTIL_NUM_BUCKETS      8
+#endif
+#ifndef CHAN_UTIL_BUCKET_MILLIS
+  #define CHAN_UTIL_BUCKET_MILLIS  15000    // ie. rolling window of 2 minutes
+#endif
+
+#ifndef RX_DELAY_SCORE_STEPS
+  #define RX_DELAY_SCORE_STEPS   32    // resolution of the score -> rx delay lookup table
+#endif
+
 #define ERR_EVENT_FULL              (1 << 0)
 #define ERR_EVENT_CAD_TIMEOUT       (1 << 1)
 #define ERR_EVENT_STARTRX_TIMEOUT   (1 << 2)
@@ -117,13 +167,26 @@ class Dispatcher {
   unsigned long outbound_expiry, outbound_start, total_air_time;
   unsigned long next_tx_time;
   unsigned long cad_busy_start;
+  uint8_t cad_attempts;     // consecutive times channel found busy, for current send
+  uint8_t last_cad_deferrals;
+  uint32_t n_cad_deferrals, n_cad_forced;
+  uint32_t n_stale_tx, n_stale_rx;
+  unsigned long next_stale_sweep;
   unsigned long radio_nonrx_start;
   unsigned long next_floor_calib_time, next_agc_reset_time;
   bool  prev_isrecv_mode;
   uint32_t n_sent_flood, n_sent_direct;
   uint32_t n_recv_flood, n_recv_direct;
+  uint32_t busy_rx[CHAN_UTIL_NUM_BUCKETS], busy_tx[CHAN_UTIL_NUM_BUCKETS], busy_cad[CHAN_UTIL_NUM_BUCKETS];  // millis
+  int busy_idx;
+  unsigned long busy_bucket_start;
+  mutable float rx_delay_base;
+  mutable float rx_delay_factor[RX_DELAY_SCORE_STEPS+1];   // (base^(0.85 - score) - 1), by score
 
-  void processRecvPacket(Packet* pkt);
+  void processRecvPacket(Packet* pkt, bool allow_retransmit=true);
+  bool isStale(const Packet* pkt) const;
+  void sweepStaleOutbound();
+  void rollBusyBuckets();
 
 protected:
   PacketManager* _mgr;
@@ -136,10 +199,20 @@ protected:
   {
     outbound = NULL; total_air_time = 0; next_tx_time = 0;
     cad_busy_start = 0;
+    cad_attempts = last_cad_deferrals = 0;
+    n_cad_deferrals = n_cad_forced = 0;
+    n_stale_tx = n_stale_rx = 0;
+    next_stale_sweep = 0;
     next_floor_calib_time = next_agc_reset_time = 0;
     _err_flags = 0;
     radio_nonrx_start = 0;
     prev_isrecv_mode = true;
+    memset(busy_rx, 0, sizeof(busy_rx));
+    memset(busy_tx, 0, sizeof(busy_tx));
+    memset(busy_cad, 0, sizeof(busy_cad));
+    busy_idx = 0;
+    busy_bucket_start = 0;
+    rx_delay_base = -1.0f;   // ie. table not built yet
   }
 
   virtual DispatcherAction onRecvPacket(Packet* pkt) = 0;
@@ -153,32 +226,81 @@ protected:
 
   virtual float getAirtimeBudgetFactor() const;
   virtual int calcRxDelay(float score, uint32_t air_time) const;
+
+  /**
+   * \returns  (base^(0.85 - score) - 1) * air_time, interpolated from a lookup table (rebuilt when 'base' changes)
+   */
+  int calcScoreDelay(float base, float score, uint32_t air_time) const;
   virtual uint32_t getCADFailRetryDelay() const;
   virtual uint32_t getCADFailMaxDuration() const;
+
+  /**
+   * \returns  millis to wait before sensing channel again, after finding it busy 'attempt' consecutive times (0 = just one slot)
+   */
+  virtual uint32_t getCADBackoffDelay(uint8_t attempt) const;
+
+  /**
+   * \brief  p-persistence, once channel is clear again after being busy.
+   * \returns  true if should transmit now, or false to defer one slot
+   */
+  virtual bool allowSendAfterBusy(uint8_t priority) { return true; }
+
+  /**
+   * \returns  max millis the given packet may wait in a queue, past when it was due, before it is stale (0 = no limit).
+   *       Stale outbound packets are discarded, stale delayed inbound packets are still processed, but not forwarded.
+   */
+  virtual uint32_t getMaxQueueAge(const Packet* packet) const { return 0; }
   virtual int getInterferenceThreshold() const { return 0; }    // disabled by default
   virtual int getAGCResetInterval() const { return 0; }    // disabled by default
 
+  /**
+   * \returns  factor (1.0 or more) to stretch intervals of background traffic (adverts, keep-alives, etc) by,
+   *        based on current channel utilisation.
+   */
+  virtual float getChannelLoadStretch() const;
+
 public:
   void begin();
   void loop();
 
-  Packet* obtainNewPacket();
+  /**
+   * \returns  millis until loop() next has something to do (timers, queued packets), or zero if it should be called
+   *           again straight away. Caller can sleep until then, BUT must also wake on radio IRQ (ie. packet received/sent).
+   */
+  virtual uint32_t getMillisToNextEvent() const;
+
+  Packet* obtainNewPacket(uint8_t priority=0xFF);   // if pool is empty, can reclaim a queued packet less important than 'priority'
   void releasePacket(Packet* packet);
   void sendPacket(Packet* packet, uint8_t priority, uint32_t delay_millis=0);
 
   unsigned long getTotalAirTime() const { return total_air_time; }  // in milliseconds
+
+  /**
+   * \returns  estimated percentage of time channel is busy (RX + TX airtime, and CAD busy), over last few minutes
+   */
+  float getChannelUtilisation() const;
+  uint32_t stretchForChannelLoad(uint32_t interval_millis) const { return interval_millis * getChannelLoadStretch(); }
   uint32_t getNumSentFlood() const { return n_sent_flood; }
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
+  uint32_t getNumCADDeferrals() const { return n_cad_deferrals; }
+  uint32_t getNumCADForced() const { return n_cad_forced; }   // sends forced after getCADFailMaxDuration()
+  uint8_t getLastCADDeferrals() const { return last_cad_deferrals; }   // for the last packet sent
+  uint32_t getNumStaleTx() const { return n_stale_tx; }   // outbound packets discarded as stale
+  uint32_t getNumStaleRx() const { return n_stale_rx; }   // delayed inbound packets too stale to forward (still processed locally)
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
+    n_cad_deferrals = n_cad_forced = 0;
+    n_stale_tx = n_stale_rx = 0;
     _err_flags = 0;
   }
 
   // helper methods
   bool millisHasNowPassed(unsigned long timestamp) const;
   unsigned long futureMillis(int millis_from_now) const;
+  void updateDeadline(uint32_t& millis, unsigned long timestamp) const;   // reduce millis, if timestamp is sooner
+  void updateDeadlines(uint32_t& millis, const unsigned long timers[], int num) const;   // same, skipping unset (zero) timers
 
 private:
   void checkRecv();
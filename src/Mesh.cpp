@@ -9,6 +9,16 @@ void Mesh::begin() {
 
 void Mesh::loop() {
   Dispatcher::loop();
+
+  if (num_held > 0) checkHeldPackets();
+}
+
+uint32_t Mesh::getMillisToNextEvent() const {
+  uint32_t millis = Dispatcher::getMillisToNextEvent();
+  for (int i = 0; i < num_held; i++) {
+    updateDeadline(millis, held[i].expiry);
+  }
+  return millis;
 }
 
 bool Mesh::allowPacketForward(const mesh::Packet* packet) { 
@@ -25,27 +35,61 @@ uint32_t Mesh::getDirectRetransmitDelay(const Packet* packet) {
 uint8_t Mesh::getExtraAckTransmitCount() const {
   return 0;
 }
+uint8_t Mesh::getPassiveAckRetries() const {
+  return 0;  // by default, disabled
+}
+float Mesh::getDirectTxDelayFactor() const {
+  return 0.0f;   // as per default getDirectRetransmitDelay()
+}
+uint32_t Mesh::getPassiveAckTimeout(const Packet* packet) {
+  // our transmit, then next hop's (assume it has similar direct tx delay to us, ie. max of 5 slots)
+  uint32_t t = _radio->getEstAirtimeFor(packet->getRawLength());
+  return t*2 + ((uint32_t)(t * getDirectTxDelayFactor()))*5 + 300;
+}
 
 uint32_t Mesh::getCADFailRetryDelay() const {
   return _rng->nextInt(1, 4)*120;
 }
+uint32_t Mesh::getCADBackoffDelay(uint8_t attempt) const {
+  // binary exponential back-off: random slot in window that doubles each attempt, plus some jitter so nodes don't stay slot aligned
+  uint8_t e = attempt < CAD_BACKOFF_MAX_EXP ? attempt : CAD_BACKOFF_MAX_EXP;
+  return _rng->nextInt(1, (1 << e) + 1)*CAD_BACKOFF_SLOT_MILLIS + _rng->nextInt(0, CAD_BACKOFF_SLOT_MILLIS / 4);
+}
+float Mesh::getCADPersistence(uint8_t priority) const {
+  return 1.0f / (1.0f + priority*0.5f);   // 1.0 for routed Direct, then 0.67, 0.5, 0.4, ...
+}
+uint32_t Mesh::getMaxQueueAge(const Packet* packet) const {
+  if (packet->isRouteFlood()) {
+    if (packet->path_len == 0) return 0;   // our own (or zero hop), so never stale
+    return FLOOD_MAX_QUEUE_AGE;
+  }
+  if (packet->getPayloadType() == PAYLOAD_TYPE_TRACE) return FLOOD_MAX_QUEUE_AGE;   // SNRs would be misleading by then
+  return DIRECT_MAX_QUEUE_AGE;
+}
+bool Mesh::allowSendAfterBusy(uint8_t priority) {
+  return _rng->nextInt(0, 1000) < (uint32_t)(getCADPersistence(priority) * 1000);
+}
 
-int Mesh::searchPeersByHash(const uint8_t* hash) {
+int Mesh::searchPeersByHash(const uint8_t* hash, uint8_t hash_size) {
   return 0;  // not found
 }
 
-int Mesh::searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int max_matches) {
+int Mesh::searchChannelsByHash(const uint8_t* hash, uint8_t hash_size, GroupChannel channels[], int max_matches) {
   return 0;  // not found
 }
 
 DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
-  if (pkt->getPayloadVer() > PAYLOAD_VER_1) {  // not supported in this firmware version
+  if (pkt->getPayloadVer() > PAYLOAD_VER_2) {  // not supported in this firmware version
     MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): unsupported packet version", getLogDateTime());
     return ACTION_RELEASE;
   }
 
+  if (pkt->isRouteFlood() && pkt->path_len >= pkt->getPathHashSize()) {   // last hash in path is the neighbour we heard it from
+    _tables->onLinkRecv(&pkt->path[pkt->path_len - pkt->getPathHashSize()], pkt->getPathHashSize(), pkt->getSNR());
+  }
+
   if (pkt->isRouteDirect() && pkt->getPayloadType() == PAYLOAD_TYPE_TRACE) {
-    if (pkt->path_len < MAX_PATH_SIZE) {
+    if (pkt->path_len < MAX_PATH_SIZE && pkt->getPayloadVer() == PAYLOAD_VER_1) {   // NOTE: TRACE path_hashes are always single byte
       uint8_t i = 0;
       uint32_t trace_tag;
       memcpy(&trace_tag, &pkt->payload[i], 4); i += 4;
@@ -55,6 +99,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
       uint8_t len = pkt->payload_len - i;
       if (pkt->path_len >= len) {   // TRACE has reached end of given path
+        if (len > 0) _tables->onLinkRecv(&pkt->payload[i + len - PATH_HASH_SIZE], PATH_HASH_SIZE, pkt->getSNR());   // heard from last hop
         onTraceRecv(pkt, trace_tag, auth_code, flags, pkt->path, &pkt->payload[i], len);
       } else if (self_id.isHashMatch(&pkt->payload[i + pkt->path_len]) && allowPacketForward(pkt) && !_tables->hasSeen(pkt)) {
         // append SNR (Not hash!)
@@ -68,8 +113,12 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
     return ACTION_RELEASE;
   }
 
-  if (pkt->isRouteDirect() && pkt->path_len >= PATH_HASH_SIZE) {
-    if (self_id.isHashMatch(pkt->path) && allowPacketForward(pkt)) {
+  if (pkt->isRouteDirect() && num_held > 0 && checkPassiveAck(pkt)) {
+    return ACTION_RELEASE;   // is the next hop forwarding a packet we sent, nothing more to do
+  }
+
+  if (pkt->isRouteDirect() && pkt->path_len >= pkt->getPathHashSize()) {
+    if (self_id.isHashMatch(pkt->path, pkt->getPathHashSize()) && allowPacketForward(pkt)) {
       if (pkt->getPayloadType() == PAYLOAD_TYPE_MULTIPART) {
         return forwardMultipartDirect(pkt);
       } else if (pkt->getPayloadType() == PAYLOAD_TYPE_ACK) {
@@ -84,6 +133,9 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         removeSelfFromPath(pkt);
 
         uint32_t d = getDirectRetransmitDelay(pkt);
+        if (pkt->path_len > 0 && getPassiveAckRetries() > 0 && holdForPassiveAck(pkt, d)) {
+          return ACTION_MANUAL_HOLD;   // a copy is queued, original is held until next hop is heard forwarding it
+        }
         return ACTION_RETRANSMIT_DELAYED(0, d);  // Routed traffic is HIGHEST priority 
       }
     }
@@ -108,22 +160,25 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
     case PAYLOAD_TYPE_PATH:
     case PAYLOAD_TYPE_REQ:
     case PAYLOAD_TYPE_RESPONSE:
-    case PAYLOAD_TYPE_TXT_MSG: {
+    case PAYLOAD_TYPE_TXT_MSG:
+    case PAYLOAD_TYPE_BULK: {
       int i = 0;
-      uint8_t dest_hash = pkt->payload[i++];
-      uint8_t src_hash = pkt->payload[i++];
+      uint8_t hash_size = pkt->getPathHashSize();
+      uint8_t mac_size = pkt->getCipherMACSize();
+      const uint8_t* dest_hash = &pkt->payload[i]; i += hash_size;
+      const uint8_t* src_hash = &pkt->payload[i]; i += hash_size;
 
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
-      if (i + CIPHER_MAC_SIZE >= pkt->payload_len) {
+      if (i + mac_size >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
         // NOTE: this is a 'first packet wins' impl. When receiving from multiple paths, the first to arrive wins.
         //       For flood mode, the path may not be the 'best' in terms of hops.
         // FUTURE: could send back multiple paths, using createPathReturn(), and let sender choose which to use(?)
 
-        if (self_id.isHashMatch(&dest_hash)) {
+        if (self_id.isHashMatch(dest_hash, hash_size)) {
           // scan contacts DB, for all matching hashes of 'src_hash' (max 4 matches supported ATM)
-          int num = searchPeersByHash(&src_hash);
+          int num = searchPeersByHash(src_hash, hash_size);
           // for each matching contact, try to decrypt data
           bool found = false;
           for (int j = 0; j < num; j++) {
@@ -132,8 +187,10 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
             // decrypt, checking MAC is valid
             uint8_t data[MAX_PACKET_PAYLOAD];
-            int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
-            if (len > 0) {  // success!
+            int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i, mac_size);
+            if (len <= 0) {
+              n_mac_fails++;   // wasted a trial decrypt
+            } else {  // success!
               if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
                 int k = 0;
                 uint8_t path_len = data[k++];
@@ -144,7 +201,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
                 if (onPeerPathRecv(pkt, j, secret, path, path_len, extra_type, extra, extra_len)) {
                   if (pkt->isRouteFlood()) {
                     // send a reciprocal return path to sender, but send DIRECTLY!
-                    mesh::Packet* rpath = createPathReturn(&src_hash, secret, pkt->path, pkt->path_len, 0, NULL, 0);
+                    mesh::Packet* rpath = createPathReturn(src_hash, secret, pkt->path, pkt->path_len, 0, NULL, 0, pkt->getPayloadVer());
                     if (rpath) sendDirect(rpath, path, path_len, 500);
                   }
                 }
@@ -158,23 +215,27 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           if (found) {
             pkt->markDoNotRetransmit();  // packet was for this node, so don't retransmit
           } else {
-            MESH_DEBUG_PRINTLN("%s recv matches no peers, src_hash=%02X", getLogDateTime(), (uint32_t)src_hash);
+            MESH_DEBUG_PRINTLN("%s recv matches no peers, src_hash=%02X", getLogDateTime(), (uint32_t)src_hash[0]);
           }
         }
-        action = routeRecvPacket(pkt);
+        if (pkt->getPayloadType() != PAYLOAD_TYPE_BULK) {   // never flood route bulk transfers
+          action = routeRecvPacket(pkt);
+        }
       }
       break;
     }
     case PAYLOAD_TYPE_ANON_REQ: {
       int i = 0;
-      uint8_t dest_hash = pkt->payload[i++];
+      uint8_t hash_size = pkt->getPathHashSize();
+      uint8_t mac_size = pkt->getCipherMACSize();
+      const uint8_t* dest_hash = &pkt->payload[i]; i += hash_size;
       uint8_t* sender_pub_key = &pkt->payload[i]; i += PUB_KEY_SIZE;
 
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
-      if (i + 2 >= pkt->payload_len) {
+      if (i + mac_size >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
-        if (self_id.isHashMatch(&dest_hash)) {
+        if (self_id.isHashMatch(dest_hash, hash_size)) {
           Identity sender(sender_pub_key);
 
           uint8_t secret[PUB_KEY_SIZE];
@@ -182,10 +243,12 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
+          int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i, mac_size);
           if (len > 0) {  // success!
             onAnonDataRecv(pkt, secret, sender, data, len);
             pkt->markDoNotRetransmit();
+          } else {
+            n_mac_fails++;
           }
         }
         action = routeRecvPacket(pkt);
@@ -195,24 +258,27 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
     case PAYLOAD_TYPE_GRP_DATA: 
     case PAYLOAD_TYPE_GRP_TXT: {
       int i = 0;
-      uint8_t channel_hash = pkt->payload[i++];
+      uint8_t hash_size = pkt->getPathHashSize();
+      uint8_t mac_size = pkt->getCipherMACSize();
+      const uint8_t* channel_hash = &pkt->payload[i]; i += hash_size;
 
       uint8_t* macAndData = &pkt->payload[i];   // MAC + encrypted data 
-      if (i + 2 >= pkt->payload_len) {
+      if (i + mac_size >= pkt->payload_len) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
         // scan channels DB, for all matching hashes of 'channel_hash' (max 2 matches supported ATM)
         GroupChannel channels[2];
-        int num = searchChannelsByHash(&channel_hash, channels, 2);
+        int num = searchChannelsByHash(channel_hash, hash_size, channels, 2);
         // for each matching channel, try to decrypt data
         for (int j = 0; j < num; j++) {
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
+          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i, mac_size);
           if (len > 0) {  // success!
             onGroupDataRecv(pkt, pkt->getPayloadType(), channels[j], data, len);
             break;
           }
+          n_mac_fails++;
         }
         action = routeRecvPacket(pkt);
       }
@@ -249,6 +315,9 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         }
         if (is_ok) {
           MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): valid advertisement received!", getLogDateTime());
+          if (pkt->isRouteFlood() && pkt->path_len == 0) {   // heard directly from the advertiser
+            _tables->onLinkRecv(id.pub_key, pkt->getPathHashSize(), pkt->getSNR());
+          }
           onAdvertRecv(pkt, id, timestamp, app_data, app_data_len);
           action = routeRecvPacket(pkt);
         } else {
@@ -300,31 +369,106 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
 void Mesh::removeSelfFromPath(Packet* pkt) {
   // remove our hash from 'path'
-  pkt->path_len -= PATH_HASH_SIZE;
-#if 0
-  memcpy(pkt->path, &pkt->path[PATH_HASH_SIZE], pkt->path_len);
-#elif PATH_HASH_SIZE == 1
-  for (int k = 0; k < pkt->path_len; k++) {  // shuffle bytes by 1
-    pkt->path[k] = pkt->path[k + 1];
+  uint8_t hash_size = pkt->getPathHashSize();
+  pkt->path_len -= hash_size;
+  for (int k = 0; k < pkt->path_len; k++) {  // shuffle bytes by hash_size
+    pkt->path[k] = pkt->path[k + hash_size];
   }
-#else
-  #error "need path remove impl"
-#endif
 }
 
 DispatcherAction Mesh::routeRecvPacket(Packet* packet) {
   if (packet->isRouteFlood() && !packet->isMarkedDoNotRetransmit()
-    && packet->path_len + PATH_HASH_SIZE <= MAX_PATH_SIZE && allowPacketForward(packet)) {
+    && packet->path_len + packet->getPathHashSize() <= MAX_PATH_SIZE && allowPacketForward(packet)) {
     // append this node's hash to 'path'
-    packet->path_len += self_id.copyHashTo(&packet->path[packet->path_len]);
+    packet->path_len += self_id.copyHashTo(&packet->path[packet->path_len], packet->getPathHashSize());
 
     uint32_t d = getRetransmitDelay(packet);
     // as this propagates outwards, give it lower and lower priority
-    return ACTION_RETRANSMIT_DELAYED(packet->path_len, d);   // give priority to closer sources, than ones further away
+    return ACTION_RETRANSMIT_DELAYED(packet->getPathHashCount(), d);   // give priority to closer sources, than ones further away
   }
   return ACTION_RELEASE;
 }
 
+bool Mesh::holdForPassiveAck(Packet* pkt, uint32_t delay_millis) {
+  if (num_held >= MAX_PASSIVE_ACK_HOLD) return false;   // table full, just forward as normal
+
+  Packet* copy = obtainNewPacket(0);
+  if (copy == NULL) return false;
+  *copy = *pkt;
+
+  HeldPacket* h = &held[num_held++];
+  h->pkt = pkt;
+  h->sent = copy;
+  pkt->calculatePacketHash(h->hash);
+  h->retries = 0;
+  h->expiry = futureMillis(delay_millis + getPassiveAckTimeout(pkt));
+
+  sendPacket(copy, 0, delay_millis);  // Routed traffic is HIGHEST priority
+  return true;
+}
+
+bool Mesh::checkPassiveAck(const Packet* pkt) {
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+
+  for (int i = 0; i < num_held; i++) {
+    // NOTE: previous hop resending it would still have our hash in path, so needs to be shorter
+    if (pkt->path_len < held[i].pkt->path_len && memcmp(hash, held[i].hash, MAX_HASH_SIZE) == 0) {
+      n_passive_acks++;
+      _tables->onLinkDelivery(held[i].pkt->path, held[i].pkt->getPathHashSize(), true);
+      removeHeld(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Mesh::isQueuedOutbound(const Packet* sent, const Packet* orig) {
+  int n = _mgr->getOutboundCount(0xFFFFFFFF);
+  for (int i = 0; i < n; i++) {
+    if (_mgr->getOutboundByIdx(i) == sent) {
+      // double check it hasn't been sent, and pool slot re-used
+      return sent->payload_len == orig->payload_len && memcmp(sent->payload, orig->payload, orig->payload_len) == 0;
+    }
+  }
+  return false;
+}
+
+void Mesh::checkHeldPackets() {
+  int i = 0;
+  while (i < num_held) {
+    HeldPacket* h = &held[i];
+    if (isQueuedOutbound(h->sent, h->pkt)) {
+      h->expiry = futureMillis(getPassiveAckTimeout(h->pkt));   // not sent yet, so don't start listening
+    } else if (millisHasNowPassed(h->expiry)) {
+      _tables->onLinkDelivery(h->pkt->path, h->pkt->getPathHashSize(), false);   // next hop not heard
+
+      Packet* copy = h->retries < getPassiveAckRetries() ? obtainNewPacket(0) : NULL;
+      if (copy == NULL) {
+        MESH_DEBUG_PRINTLN("%s Mesh::checkHeldPackets(): next hop not heard, giving up", getLogDateTime());
+        n_passive_fails++;
+        removeHeld(i);
+        continue;
+      }
+      *copy = *h->pkt;
+      h->sent = copy;
+      h->retries++;
+      n_passive_retries++;
+      h->expiry = futureMillis(getPassiveAckTimeout(h->pkt));
+      sendPacket(copy, 0);
+    }
+    i++;
+  }
+}
+
+void Mesh::removeHeld(int i) {
+  releasePacket(held[i].pkt);
+  num_held--;
+  for (; i < num_held; i++) {
+    held[i] = held[i + 1];
+  }
+}
+
 DispatcherAction Mesh::forwardMultipartDirect(Packet* pkt) {
   uint8_t remaining = pkt->payload[0] >> 4;  // num of packets in this multipart sequence still to be sent
   uint8_t type = pkt->payload[0] & 0x0F;
@@ -353,21 +497,23 @@ void Mesh::routeDirectRecvAcks(Packet* packet, uint32_t delay_millis) {
     uint8_t extra = getExtraAckTransmitCount();
     while (extra > 0) {
       delay_millis += getDirectRetransmitDelay(packet) + 300;
-      auto a1 = createMultiAck(crc, extra);
+      auto a1 = createMultiAck(crc, extra, packet->getPayloadVer());
       if (a1) {
         memcpy(a1->path, packet->path, a1->path_len = packet->path_len);
         a1->header &= ~PH_ROUTE_MASK;
         a1->header |= ROUTE_TYPE_DIRECT;
+        a1->_is_local = false;   // forwarding
         sendPacket(a1, 0, delay_millis);
       }
       extra--;
     }
 
-    auto a2 = createAck(crc);
+    auto a2 = createAck(crc, packet->getPayloadVer());
     if (a2) {
       memcpy(a2->path, packet->path, a2->path_len = packet->path_len);
       a2->header &= ~PH_ROUTE_MASK;
       a2->header |= ROUTE_TYPE_DIRECT;
+      a2->_is_local = false;
       sendPacket(a2, 0, delay_millis);
     }
   }
@@ -409,27 +555,32 @@ Packet* Mesh::createAdvert(const LocalIdentity& id, const uint8_t* app_data, siz
   return packet;
 }
 
-#define MAX_COMBINED_PATH  (MAX_PACKET_PAYLOAD - 2 - CIPHER_BLOCK_SIZE)
+static int calcEncryptedLen(int data_len) {   // as per Utils::encrypt(), padded to cipher block size
+  return ((data_len + CIPHER_BLOCK_SIZE-1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+}
 
-Packet* Mesh::createPathReturn(const Identity& dest, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len) {
-  uint8_t dest_hash[PATH_HASH_SIZE];
-  dest.copyHashTo(dest_hash);
-  return createPathReturn(dest_hash, secret, path, path_len, extra_type, extra, extra_len);
+Packet* Mesh::createPathReturn(const Identity& dest, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len, uint8_t ver) {
+  uint8_t dest_hash[MAX_PATH_HASH_SIZE];
+  dest.copyHashTo(dest_hash, Packet::getPathHashSizeFor(ver));
+  return createPathReturn(dest_hash, secret, path, path_len, extra_type, extra, extra_len, ver);
 }
 
-Packet* Mesh::createPathReturn(const uint8_t* dest_hash, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len) {
-  if (path_len + extra_len + 5 > MAX_COMBINED_PATH) return NULL;  // too long!!
+Packet* Mesh::createPathReturn(const uint8_t* dest_hash, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len, uint8_t ver) {
+  uint8_t hash_size = Packet::getPathHashSizeFor(ver);
+  uint8_t mac_size = Packet::getCipherMACSizeFor(ver);
+  int max_data_len = 1 + path_len + 1 + (extra_len > 4 ? extra_len : 4);
+  if (2*hash_size + mac_size + calcEncryptedLen(max_data_len) > MAX_PACKET_PAYLOAD) return NULL;  // too long!!
 
-  Packet* packet = obtainNewPacket();
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createPathReturn(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (PAYLOAD_TYPE_PATH << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (PAYLOAD_TYPE_PATH << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   int len = 0;
-  memcpy(&packet->payload[len], dest_hash, PATH_HASH_SIZE); len += PATH_HASH_SIZE;  // dest hash
-  len += self_id.copyHashTo(&packet->payload[len]);  // src hash
+  memcpy(&packet->payload[len], dest_hash, hash_size); len += hash_size;  // dest hash
+  len += self_id.copyHashTo(&packet->payload[len], hash_size);  // src hash
 
   {
     int data_len = 0;
@@ -446,7 +597,7 @@ Packet* Mesh::createPathReturn(const uint8_t* dest_hash, const uint8_t* secret,
       getRNG()->random(&data[data_len], 4); data_len += 4;
     }
 
-    len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len);
+    len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len, mac_size);
   }
 
   packet->payload_len = len;
@@ -454,85 +605,91 @@ Packet* Mesh::createPathReturn(const uint8_t* dest_hash, const uint8_t* secret,
   return packet;
 }
 
-Packet* Mesh::createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len) {
-  if (type == PAYLOAD_TYPE_TXT_MSG || type == PAYLOAD_TYPE_REQ || type == PAYLOAD_TYPE_RESPONSE) {
-    if (data_len + CIPHER_MAC_SIZE + CIPHER_BLOCK_SIZE-1 > MAX_PACKET_PAYLOAD) return NULL;
+Packet* Mesh::createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len, uint8_t ver) {
+  uint8_t hash_size = Packet::getPathHashSizeFor(ver);
+  uint8_t mac_size = Packet::getCipherMACSizeFor(ver);
+  if (type == PAYLOAD_TYPE_TXT_MSG || type == PAYLOAD_TYPE_REQ || type == PAYLOAD_TYPE_RESPONSE || type == PAYLOAD_TYPE_BULK) {
+    if (2*hash_size + mac_size + calcEncryptedLen(data_len) > MAX_PACKET_PAYLOAD) return NULL;
   } else {
     return NULL;  // invalid type
   }
 
-  Packet* packet = obtainNewPacket();
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createDatagram(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (type << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (type << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   int len = 0;
-  len += dest.copyHashTo(&packet->payload[len]);  // dest hash
-  len += self_id.copyHashTo(&packet->payload[len]);  // src hash
-  len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len);
+  len += dest.copyHashTo(&packet->payload[len], hash_size);  // dest hash
+  len += self_id.copyHashTo(&packet->payload[len], hash_size);  // src hash
+  len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len, mac_size);
 
   packet->payload_len = len;
 
   return packet;
 }
 
-Packet* Mesh::createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len) {
+Packet* Mesh::createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len, uint8_t ver) {
+  uint8_t hash_size = Packet::getPathHashSizeFor(ver);
+  uint8_t mac_size = Packet::getCipherMACSizeFor(ver);
   if (type == PAYLOAD_TYPE_ANON_REQ) {
-    if (data_len + 1 + PUB_KEY_SIZE + CIPHER_BLOCK_SIZE-1 > MAX_PACKET_PAYLOAD) return NULL;
+    if (hash_size + PUB_KEY_SIZE + mac_size + calcEncryptedLen(data_len) > MAX_PACKET_PAYLOAD) return NULL;
   } else {
     return NULL;  // invalid type
   }
 
-  Packet* packet = obtainNewPacket();
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createAnonDatagram(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (type << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (type << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   int len = 0;
   if (type == PAYLOAD_TYPE_ANON_REQ) {
-    len += dest.copyHashTo(&packet->payload[len]);  // dest hash
+    len += dest.copyHashTo(&packet->payload[len], hash_size);  // dest hash
     memcpy(&packet->payload[len], sender.pub_key, PUB_KEY_SIZE); len += PUB_KEY_SIZE;  // sender pub_key
   } else {
     // FUTURE:
   }
-  len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len);
+  len += Utils::encryptThenMAC(secret, &packet->payload[len], data, data_len, mac_size);
 
   packet->payload_len = len;
 
   return packet;
 }
 
-Packet* Mesh::createGroupDatagram(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len) {
+Packet* Mesh::createGroupDatagram(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len, uint8_t ver) {
+  uint8_t hash_size = Packet::getPathHashSizeFor(ver);
+  uint8_t mac_size = Packet::getCipherMACSizeFor(ver);
   if (!(type == PAYLOAD_TYPE_GRP_TXT || type == PAYLOAD_TYPE_GRP_DATA)) return NULL;   // invalid type
-  if (data_len + 1 + CIPHER_BLOCK_SIZE-1 > MAX_PACKET_PAYLOAD) return NULL; // too long
+  if (hash_size + mac_size + calcEncryptedLen(data_len) > MAX_PACKET_PAYLOAD) return NULL; // too long
 
-  Packet* packet = obtainNewPacket();
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createGroupDatagram(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (type << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (type << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   int len = 0;
-  memcpy(&packet->payload[len], channel.hash, PATH_HASH_SIZE); len += PATH_HASH_SIZE;
-  len += Utils::encryptThenMAC(channel.secret, &packet->payload[len], data, data_len);
+  memcpy(&packet->payload[len], channel.hash, hash_size); len += hash_size;
+  len += Utils::encryptThenMAC(channel.secret, &packet->payload[len], data, data_len, mac_size);
 
   packet->payload_len = len;
 
   return packet;
 }
 
-Packet* Mesh::createAck(uint32_t ack_crc) {
-  Packet* packet = obtainNewPacket();
+Packet* Mesh::createAck(uint32_t ack_crc, uint8_t ver) {
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createAck(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (PAYLOAD_TYPE_ACK << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (PAYLOAD_TYPE_ACK << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   memcpy(packet->payload, &ack_crc, 4);
   packet->payload_len = 4;
@@ -540,13 +697,13 @@ Packet* Mesh::createAck(uint32_t ack_crc) {
   return packet;
 }
 
-Packet* Mesh::createMultiAck(uint32_t ack_crc, uint8_t remaining) {
-  Packet* packet = obtainNewPacket();
+Packet* Mesh::createMultiAck(uint32_t ack_crc, uint8_t remaining, uint8_t ver) {
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createMultiAck(): error, packet pool empty", getLogDateTime());
     return NULL;
   }
-  packet->header = (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->header = (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT) | (ver << PH_VER_SHIFT);  // ROUTE_TYPE_* set later
 
   packet->payload[0] = (remaining << 4) | PAYLOAD_TYPE_ACK;
   memcpy(&packet->payload[1], &ack_crc, 4);
@@ -558,7 +715,7 @@ Packet* Mesh::createMultiAck(uint32_t ack_crc, uint8_t remaining) {
 Packet* Mesh::createRawData(const uint8_t* data, size_t len) {
   if (len > sizeof(Packet::payload)) return NULL;  // invalid arg
 
-  Packet* packet = obtainNewPacket();
+  Packet* packet = obtainNewPacket(OWN_PACKET_PRIORITY);
   if (packet == NULL) {
     MESH_DEBUG_PRINTLN("%s Mesh::createRawData(): error, packet pool empty", getLogDateTime());
     return NULL;
@@ -626,6 +783,8 @@ void Mesh::sendDirect(Packet* packet, const uint8_t* path, uint8_t path_len, uin
     memcpy(packet->path, path, packet->path_len = path_len);
     if (packet->getPayloadType() == PAYLOAD_TYPE_PATH) {
       pri = 1;   // slightly less priority
+    } else if (packet->getPayloadType() == PAYLOAD_TYPE_BULK) {
+      pri = 2;   // bulk transfers yield to interactive traffic
     } else {
       pri = 0;
     }
@@ -2,14 +2,52 @@
 
 #include <Dispatcher.h>
 
+#ifndef CAD_BACKOFF_SLOT_MILLIS
+  #define CAD_BACKOFF_SLOT_MILLIS   120
+#endif
+#ifndef CAD_BACKOFF_MAX_EXP
+  #define CAD_BACKOFF_MAX_EXP         5    // ie. contention window of up to 32 slots
+#endif
+
+#ifndef FLOOD_MAX_QUEUE_AGE
+  #define FLOOD_MAX_QUEUE_AGE      8000    // by then, neighbours will have relayed it
+#endif
+#ifndef DIRECT_MAX_QUEUE_AGE
+  #define DIRECT_MAX_QUEUE_AGE    20000    // by then, sender has likely timed out
+#endif
+
+#ifndef OWN_PACKET_PRIORITY
+  #define OWN_PACKET_PRIORITY    1    // own packets can reclaim queued ones less important than this, if pool is empty
+#endif
+
+#ifndef MAX_PASSIVE_ACK_HOLD
+  #define MAX_PASSIVE_ACK_HOLD   4    // max forwarded Direct packets held, waiting to overhear next hop
+#endif
+
 namespace mesh {
 
 class GroupChannel {
 public:
-  uint8_t hash[PATH_HASH_SIZE];
+  uint8_t hash[MAX_PATH_HASH_SIZE];
   uint8_t secret[PUB_KEY_SIZE];
 };
 
+#define LINK_MAX_ETX   20.0f
+
+/**
+ * \brief  Estimated quality of link with a neighbour
+*/
+struct LinkQuality {
+  uint8_t hash[MAX_PATH_HASH_SIZE];
+  uint8_t hash_size;
+  float snr;          // EWMA of SNR of packets heard from this neighbour
+  float delivery;     // EWMA of delivery ratio of packets sent via this neighbour (0..1)
+  uint16_t n_heard, n_sent;
+  uint32_t last_update;
+
+  float getETX() const { return delivery > 1.0f/LINK_MAX_ETX ? 1.0f/delivery : LINK_MAX_ETX; }   // expected transmissions
+};
+
 /**
  * An abstraction of the data tables needed to be maintained
 */
@@ -17,6 +55,13 @@ class MeshTables {
 public:
   virtual bool hasSeen(const Packet* packet) = 0;
   virtual void clear(const Packet* packet) = 0;   // remove this packet hash from table
+
+  // optional link quality estimates, for neighbours (by path hash)
+  virtual void onLinkRecv(const uint8_t* hash, uint8_t hash_size, float snr) { }   // neighbour was heard directly
+  virtual void onLinkDelivery(const uint8_t* hash, uint8_t hash_size, bool delivered) { }   // outcome of packet sent via neighbour
+  virtual const LinkQuality* findLink(const uint8_t* hash, uint8_t hash_size) const { return NULL; }
+  virtual int getNumLinks() const { return 0; }
+  virtual const LinkQuality* getLinkByIdx(int i) const { return NULL; }
 };
 
 /**
@@ -27,16 +72,42 @@ class Mesh : public Dispatcher {
   RTCClock* _rtc;
   RNG* _rng;
   MeshTables* _tables;
+  uint32_t n_mac_fails;
+
+  struct HeldPacket {
+    Packet* pkt;         // the original, held until next hop is overheard
+    Packet* sent;        // the copy last queued for sending
+    uint8_t hash[MAX_HASH_SIZE];
+    unsigned long expiry;
+    uint8_t retries;
+  };
+  HeldPacket held[MAX_PASSIVE_ACK_HOLD];
+  int num_held;
+  uint32_t n_passive_acks, n_passive_retries, n_passive_fails;
 
   void removeSelfFromPath(Packet* packet);
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
   DispatcherAction forwardMultipartDirect(Packet* pkt);
+  bool holdForPassiveAck(Packet* pkt, uint32_t delay_millis);
+  bool checkPassiveAck(const Packet* pkt);
+  bool isQueuedOutbound(const Packet* sent, const Packet* orig);
+  void checkHeldPackets();
+  void removeHeld(int i);
 
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
 
   virtual uint32_t getCADFailRetryDelay() const override;
+  virtual uint32_t getCADBackoffDelay(uint8_t attempt) const override;
+  virtual bool allowSendAfterBusy(uint8_t priority) override;
+
+  /**
+   * \returns  probability (0..1) of sending in a slot, once channel is clear after being busy. (by default, lower for less important priorities)
+   */
+  virtual float getCADPersistence(uint8_t priority) const;
+
+  virtual uint32_t getMaxQueueAge(const Packet* packet) const override;
 
   /**
    * \brief  Decide what to do with received packet, ie. discard, forward, or hold
@@ -64,11 +135,29 @@ protected:
    */
   virtual uint8_t getExtraAckTransmitCount() const;
 
+  /**
+   * \returns  max number of local retransmissions of a forwarded Direct packet, if the next hop is not overheard
+   *       forwarding it in turn (ie. a passive hop ACK). Zero to disable.
+   */
+  virtual uint8_t getPassiveAckRetries() const;
+
+  /**
+   * \returns  size of the random slots in getDirectRetransmitDelay(), as a factor of packet airtime. Used to estimate
+   *       how long the next hop may hold a packet (see getPassiveAckTimeout()).
+   */
+  virtual float getDirectTxDelayFactor() const;
+
+  /**
+   * \returns  number of milliseconds to listen for the next hop forwarding the given packet, after this node has sent it.
+   */
+  virtual uint32_t getPassiveAckTimeout(const Packet* packet);
+
   /**
    * \brief  Perform search of local DB of peers/contacts.
+   * \param  hash_size   number of bytes in hash (depends on PAYLOAD_VER_)
    * \returns  Number of peers with matching hash
    */
-  virtual int searchPeersByHash(const uint8_t* hash);
+  virtual int searchPeersByHash(const uint8_t* hash, uint8_t hash_size);
 
   /**
    * \brief  lookup the ECDH shared-secret between this node and peer by idx (calculate if necessary)
@@ -94,8 +183,8 @@ protected:
    * \param  auth_code   a code to authenticate the packet
    * \param  flags       zero for now
    * \param  path_snrs   single byte SNR*4 for each hop in the path
-   * \param  path_hashes hashes if each repeater in the path
-   * \param  path_len    length of the path_snrs[] and path_hashes[] arrays
+   * \param  path_hashes hashes if each repeater in the path (each is packet->getPathHashSize() bytes)
+   * \param  path_len    length of the path_snrs[] and path_hashes[] arrays (in bytes)
   */
   virtual void onTraceRecv(Packet* packet, uint32_t tag, uint32_t auth_code, uint8_t flags, const uint8_t* path_snrs, const uint8_t* path_hashes, uint8_t path_len) { }
 
@@ -135,10 +224,11 @@ protected:
 
   /**
    * \brief  Perform search of local DB of matching GroupChannels.
+   * \param  hash_size   number of bytes in hash (depends on PAYLOAD_VER_)
    * \param  channels  OUT - store matching channels in this array, up to max_matches
    * \returns  Number of channels with matching hash
    */
-  virtual int searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int max_matches);
+  virtual int searchChannelsByHash(const uint8_t* hash, uint8_t hash_size, GroupChannel channels[], int max_matches);
 
   /**
    * \brief  An encrypted group data packet has been received.
@@ -157,6 +247,9 @@ protected:
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
     : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
   {
+    n_mac_fails = 0;
+    num_held = 0;
+    n_passive_acks = n_passive_retries = n_passive_fails = 0;
   }
 
   MeshTables* getTables() const { return _tables; }
@@ -164,20 +257,36 @@ protected:
 public:
   void begin();
   void loop();
+  uint32_t getMillisToNextEvent() const override;
 
   LocalIdentity self_id;
 
   RNG* getRNG() const { return _rng; }
   RTCClock* getRTCClock() const { return _rtc; }
 
+  /**
+   * \returns  number of trial decryptions (of packets with our dest hash) which failed the MAC check
+   */
+  uint32_t getNumMACFails() const { return n_mac_fails; }
+  void resetMACFails() { n_mac_fails = 0; }
+
+  /**
+   * \returns  counts of forwarded Direct packets the next hop was overheard forwarding, local retransmissions, and those given up on
+   */
+  uint32_t getNumPassiveAcks() const { return n_passive_acks; }
+  uint32_t getNumPassiveRetries() const { return n_passive_retries; }
+  uint32_t getNumPassiveFails() const { return n_passive_fails; }
+  void resetPassiveAckStats() { n_passive_acks = n_passive_retries = n_passive_fails = 0; }
+
+  // NOTE: 'ver' is one of PAYLOAD_VER_*, and also determines the hash size expected in 'path' (for sendDirect())
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
-  Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len);
-  Packet* createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len);
-  Packet* createGroupDatagram(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len);
-  Packet* createAck(uint32_t ack_crc);
-  Packet* createMultiAck(uint32_t ack_crc, uint8_t remaining);
-  Packet* createPathReturn(const uint8_t* dest_hash, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len);
-  Packet* createPathReturn(const Identity& dest, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len);
+  Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createGroupDatagram(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createAck(uint32_t ack_crc, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createMultiAck(uint32_t ack_crc, uint8_t remaining, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createPathReturn(const uint8_t* dest_hash, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len, uint8_t ver=PAYLOAD_VER_1);
+  Packet* createPathReturn(const Identity& dest, const uint8_t* secret, const uint8_t* path, uint8_t path_len, uint8_t extra_type, const uint8_t*extra, size_t extra_len, uint8_t ver=PAYLOAD_VER_1);
   Packet* createRawData(const uint8_t* data, size_t len);
   Packet* createTrace(uint32_t tag, uint32_t auth_code, uint8_t flags = 0);
 
@@ -15,6 +15,13 @@
 #define CIPHER_MAC_SIZE      2
 #define PATH_HASH_SIZE       1
 
+// V2
+#define CIPHER_MAC_SIZE_V2   4
+#define PATH_HASH_SIZE_V2    2
+
+#define MAX_CIPHER_MAC_SIZE  CIPHER_MAC_SIZE_V2
+#define MAX_PATH_HASH_SIZE   PATH_HASH_SIZE_V2
+
 #define MAX_PACKET_PAYLOAD  184
 #define MAX_PATH_SIZE        64
 #define MAX_TRANS_UNIT      255
@@ -41,6 +48,7 @@ public:
   virtual void onAfterTransmit() { }
   virtual void reboot() = 0;
   virtual void powerOff() { /* no op */ }
+  virtual void sleep(uint32_t millis) { /* no op */ }   // low power until millis have passed, or radio IRQ
   virtual uint8_t getStartupReason() const = 0;
   virtual bool startOTAUpdate(const char* id, char reply[]) { return false; }   // not supported
 };
@@ -8,6 +8,8 @@ Packet::Packet() {
   header = 0;
   path_len = 0;
   payload_len = 0;
+  _due_at = 0;
+  _is_local = false;
 }
 
 int Packet::getRawLength() const {
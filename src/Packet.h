@@ -27,11 +27,12 @@ namespace mesh {
 #define PAYLOAD_TYPE_PATH        0x08    // returned path (prefixed with dest/src hashes, MAC) (enc data: path, extra)
 #define PAYLOAD_TYPE_TRACE       0x09    // trace a path, collecting SNI for each hop
 #define PAYLOAD_TYPE_MULTIPART   0x0A    // packet is one of a set of packets
+#define PAYLOAD_TYPE_BULK        0x0B    // fragment or SACK of a bulk transfer, direct route only (prefixed with dest/src hashes, MAC) (enc data: see BulkTransfer.h)
 //...
 #define PAYLOAD_TYPE_RAW_CUSTOM   0x0F    // custom packet as raw bytes, for applications with custom encryption, payloads, etc
 
 #define PAYLOAD_VER_1       0x00   // 1-byte src/dest hashes, 2-byte MAC
-#define PAYLOAD_VER_2       0x01   // FUTURE (eg. 2-byte hashes, 4-byte MAC ??)
+#define PAYLOAD_VER_2       0x01   // 2-byte src/dest/path hashes, 4-byte MAC
 #define PAYLOAD_VER_3       0x02   // FUTURE
 #define PAYLOAD_VER_4       0x03   // FUTURE
 
@@ -48,6 +49,8 @@ public:
   uint8_t path[MAX_PATH_SIZE];
   uint8_t payload[MAX_PACKET_PAYLOAD];
   int8_t _snr;
+  uint32_t _due_at;   // millis when queued to be sent/processed (for detecting stale packets)
+  bool _is_local;     // originated by this node (ie. not being forwarded)
 
   /**
    * \brief calculate the hash of payload + type
@@ -75,6 +78,23 @@ public:
    */
   uint8_t getPayloadVer() const { return (header >> PH_VER_SHIFT) & PH_VER_MASK; }
 
+  /**
+   * \returns  size of src/dest hashes, and of each hash in 'path', for this packet's PAYLOAD_VER_
+   */
+  uint8_t getPathHashSize() const { return getPathHashSizeFor(getPayloadVer()); }
+  static uint8_t getPathHashSizeFor(uint8_t ver) { return ver == PAYLOAD_VER_2 ? PATH_HASH_SIZE_V2 : PATH_HASH_SIZE; }
+
+  /**
+   * \returns  size of cipher MAC, for this packet's PAYLOAD_VER_
+   */
+  uint8_t getCipherMACSize() const { return getCipherMACSizeFor(getPayloadVer()); }
+  static uint8_t getCipherMACSizeFor(uint8_t ver) { return ver == PAYLOAD_VER_2 ? CIPHER_MAC_SIZE_V2 : CIPHER_MAC_SIZE; }
+
+  /**
+   * \returns  number of hops in 'path'
+   */
+  uint8_t getPathHashCount() const { return path_len / getPathHashSize(); }
+
   void markDoNotRetransmit() { header = 0xFF; }
   bool isMarkedDoNotRetransmit() const { return header == 0xFF; }
 
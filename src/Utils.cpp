@@ -60,29 +60,29 @@ int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return dp - dest;  // will always be multiple of 16
 }
 
-int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  int enc_len = encrypt(shared_secret, dest + CIPHER_MAC_SIZE, src, src_len);
+int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len, uint8_t mac_size) {
+  int enc_len = encrypt(shared_secret, dest + mac_size, src, src_len);
 
   SHA256 sha;
   sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-  sha.update(dest + CIPHER_MAC_SIZE, enc_len);
-  sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, dest, CIPHER_MAC_SIZE);
+  sha.update(dest + mac_size, enc_len);
+  sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, dest, mac_size);
 
-  return CIPHER_MAC_SIZE + enc_len;
+  return mac_size + enc_len;
 }
 
-int Utils::MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  if (src_len <= CIPHER_MAC_SIZE) return 0;  // invalid src bytes
+int Utils::MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len, uint8_t mac_size) {
+  if (src_len <= mac_size || mac_size > MAX_CIPHER_MAC_SIZE) return 0;  // invalid src bytes
 
-  uint8_t hmac[CIPHER_MAC_SIZE];
+  uint8_t hmac[MAX_CIPHER_MAC_SIZE];
   {
     SHA256 sha;
     sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-    sha.update(src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
-    sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, hmac, CIPHER_MAC_SIZE);
+    sha.update(src + mac_size, src_len - mac_size);
+    sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, hmac, mac_size);
   }
-  if (memcmp(hmac, src, CIPHER_MAC_SIZE) == 0) {
-    return decrypt(shared_secret, dest, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
+  if (memcmp(hmac, src, mac_size) == 0) {
+    return decrypt(shared_secret, dest, src + mac_size, src_len - mac_size);
   }
   return 0; // invalid HMAC
 }
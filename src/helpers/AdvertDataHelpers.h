@@ -16,6 +16,10 @@
 #define ADV_FEAT2_MASK        0x40   // FUTURE
 #define ADV_NAME_MASK         0x80
 
+// Feat1 bits
+#define ADV_FEAT1_PAYLOAD_V2  0x0001   // can receive PAYLOAD_VER_2 packets
+#define ADV_FEAT1_TXT_COMPRESSED  0x0002   // can decode TXT_TYPE_COMPRESSED messages
+
 class AdvertDataBuilder {
   uint8_t _type;
   bool _has_loc;
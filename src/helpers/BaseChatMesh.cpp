@@ -1,5 +1,6 @@
 #include <helpers/BaseChatMesh.h>
 #include <Utils.h>
+#include <ctype.h>
 
 #ifndef SERVER_RESPONSE_DELAY
   #define SERVER_RESPONSE_DELAY   300
@@ -9,11 +10,16 @@
   #define TXT_ACK_DELAY     200
 #endif
 
+#ifndef BULK_RECV_TIMEOUT
+  #define BULK_RECV_TIMEOUT   60000   // millis, before an incomplete transfer can be replaced by one from another contact
+#endif
+
 mesh::Packet* BaseChatMesh::createSelfAdvert(const char* name) {
   uint8_t app_data[MAX_ADVERT_DATA_SIZE];
   uint8_t app_data_len;
   {
     AdvertDataBuilder builder(ADV_TYPE_CHAT, name);
+    builder.setFeat1(ADV_FEAT1_PAYLOAD_V2 | ADV_FEAT1_TXT_COMPRESSED);
     app_data_len = builder.encodeTo(app_data);
   }
 
@@ -25,25 +31,34 @@ mesh::Packet* BaseChatMesh::createSelfAdvert(const char* name, double lat, doubl
   uint8_t app_data_len;
   {
     AdvertDataBuilder builder(ADV_TYPE_CHAT, name, lat, lon);
+    builder.setFeat1(ADV_FEAT1_PAYLOAD_V2 | ADV_FEAT1_TXT_COMPRESSED);
     app_data_len = builder.encodeTo(app_data);
   }
 
   return createAdvert(self_id, app_data, app_data_len);
 }
 
+uint8_t BaseChatMesh::getPayloadVerFor(const ContactInfo& contact) const {
+  if (contact.out_path_len >= 0) {
+    return contact.out_path_ver;   // must match the hash size in out_path
+  }
+  return isPayloadV2Enabled() ? contact.payload_ver : PAYLOAD_VER_1;
+}
+
 void BaseChatMesh::sendAckTo(const ContactInfo& dest, uint32_t ack_hash) {
+  uint8_t ver = getPayloadVerFor(dest);
   if (dest.out_path_len < 0) {
-    mesh::Packet* ack = createAck(ack_hash);
+    mesh::Packet* ack = createAck(ack_hash, ver);
     if (ack) sendFlood(ack, TXT_ACK_DELAY);
   } else {
     uint32_t d = TXT_ACK_DELAY;
     if (getExtraAckTransmitCount() > 0) {
-      mesh::Packet* a1 = createMultiAck(ack_hash, 1);
+      mesh::Packet* a1 = createMultiAck(ack_hash, 1, ver);
       if (a1) sendDirect(a1, dest.out_path, dest.out_path_len, d);
       d += 300;
     }
 
-    mesh::Packet* a2 = createAck(ack_hash);
+    mesh::Packet* a2 = createAck(ack_hash, ver);
     if (a2) sendDirect(a2, dest.out_path, dest.out_path_len, d);
   }
 }
@@ -55,16 +70,12 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     return;
   }
 
-  ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
-      break;
-    }
+  uint8_t payload_ver = (parser.getFeat1() & ADV_FEAT1_PAYLOAD_V2) ? PAYLOAD_VER_2 : PAYLOAD_VER_1;
+
+  ContactInfo* from = lookupContactByPubKey(id.pub_key, PUB_KEY_SIZE);   // is from one of our contacts?
+  if (from && timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+    MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+    return;
   }
 
   // save a copy of raw advert packet (to support "Share..." function)
@@ -78,6 +89,9 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
       memset(&ci, 0, sizeof(ci));
       ci.id = id;
       ci.out_path_len = -1;  // initially out_path is unknown
+      ci.out_path_ver = PAYLOAD_VER_1;
+      ci.payload_ver = payload_ver;
+      ci.adv_feat1 = parser.getFeat1();
       StrHelper::strncpy(ci.name, parser.getName(), sizeof(ci.name));
       ci.type = parser.getType();
       if (parser.hasLatLon()) {
@@ -91,16 +105,15 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     }
 
     is_new = true;
-    if (num_contacts < MAX_CONTACTS) {
-      from = &contacts[num_contacts++];
+    int slot = allocContact(id, timestamp);
+    if (slot >= 0) {
+      from = &contacts[slot];
       from->id = id;
       from->out_path_len = -1;  // initially out_path is unknown
+      from->out_path_ver = PAYLOAD_VER_1;
       from->gps_lat = 0;   // initially unknown GPS loc
       from->gps_lon = 0;
       from->sync_since = 0;
-
-      // only need to calculate the shared_secret once, for better performance
-      self_id.calcSharedSecret(from->shared_secret, id);
     } else {
       MESH_DEBUG_PRINTLN("onAdvertRecv: contacts table is full!");
       return;
@@ -108,32 +121,79 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
   }
 
   // update
+  int slot = from - contacts;
+  bool renamed = is_new || strncmp(from->name, parser.getName(), sizeof(from->name) - 1) != 0;
+  if (renamed && !is_new) unindexName(slot);
   StrHelper::strncpy(from->name, parser.getName(), sizeof(from->name));
+  if (renamed) indexName(slot);
   from->type = parser.getType();
   if (parser.hasLatLon()) {
     from->gps_lat = parser.getIntLat();
     from->gps_lon = parser.getIntLon();
   }
+  if (from->out_path_len >= 0 && from->out_path_ver > payload_ver) {
+    from->out_path_len = -1;   // they can no longer receive packets in the format of this path
+  }
+  from->payload_ver = payload_ver;
+  from->adv_feat1 = parser.getFeat1();
   from->last_advert_timestamp = timestamp;
+  recent.update(slot, timestamp);
   from->lastmod = getRTCClock()->getCurrentTime();
 
   onDiscoveredContact(*from, is_new, packet->path_len, packet->path);       // let UI know
 }
 
-int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
+int BaseChatMesh::searchPeersByHash(const uint8_t* hash, uint8_t hash_size) {
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
-    if (contacts[i].id.isHashMatch(hash)) {
-      matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
+  for (int i = contact_idx.first(hash[0]); i >= 0 && n < MAX_SEARCH_RESULTS; i = contact_idx.next(i)) {
+    if (contacts[i].id.isHashMatch(hash, hash_size)) {
+      matching_peer_indexes[n++] = i;  // store the SLOTS of matching contacts (for subsequent 'peer' methods)
     }
   }
+#ifdef MAX_COLD_CONTACTS
+  cold_calcs_left = COLD_SECRET_CALCS_PER_PACKET;
+  int len = hash_size < COLD_KEY_PREFIX_LEN ? hash_size : COLD_KEY_PREFIX_LEN;
+  for (int i = cold_idx.first(hash[0]); i >= 0 && n < MAX_SEARCH_RESULTS; i = cold_idx.next(i)) {
+    if (memcmp(cold_prefix[i], hash, len) == 0) {
+      matching_peer_indexes[n++] = -1 - i;   // cold, only paged in once a packet from them decrypts OK
+    }
+  }
+#endif
   return n;
 }
 
+int BaseChatMesh::resolvePeerSlot(int i) {
+#ifdef MAX_COLD_CONTACTS
+  if (i < 0) return pageInContact(-1 - i);
+  if (contact_idx.isUsed(i)) touchContact(i);
+#endif
+  return contact_idx.isUsed(i) ? i : -1;
+}
+
 void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
   int i = matching_peer_indexes[peer_idx];
-  if (i >= 0 && i < num_contacts) {
-    // lookup pre-calculated shared_secret
+#ifdef MAX_COLD_CONTACTS
+  if (i < 0) {
+    int cold = -1 - i;   // try the MAC, without disturbing the hot set
+    if (!isColdSecretReady(cold)) {
+      if (cold_calcs_left <= 0) {   // don't let one packet trigger lots of storage reads + ECDH
+        MESH_DEBUG_PRINTLN("getPeerSharedSecret: cold secret not ready: %d", cold);
+        memset(dest_secret, 0, PUB_KEY_SIZE);   // ie. MAC will fail
+        return;
+      }
+      cold_calcs_left--;
+      if (!calcColdSecret(cold)) {
+        MESH_DEBUG_PRINTLN("getPeerSharedSecret: unable to read cold contact: %d", cold);
+        memset(dest_secret, 0, PUB_KEY_SIZE);
+        return;
+      }
+    }
+    memcpy(dest_secret, cold_secret[cold], PUB_KEY_SIZE);
+    return;
+  }
+#endif
+  if (contact_idx.isUsed(i)) {
+    ensureSharedSecret(i);
     memcpy(dest_secret, contacts[i].shared_secret, PUB_KEY_SIZE);
   } else {
     MESH_DEBUG_PRINTLN("getPeerSharedSecret: Invalid peer idx: %d", i);
@@ -141,9 +201,9 @@ void BaseChatMesh::getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) {
 }
 
 void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", i);
+  int i = resolvePeerSlot(matching_peer_indexes[sender_idx]);
+  if (i < 0) {
+    MESH_DEBUG_PRINTLN("onPeerDataRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return;
   }
 
@@ -157,6 +217,15 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
     // len can be > original length, but 'text' will be padded with zeroes
     data[len] = 0; // need to make a C string again, with null terminator
 
+    uint8_t unpacked[5 + MAX_TEXT_LEN + 1];
+    if (flags == TXT_TYPE_COMPRESSED) {
+      memcpy(unpacked, data, 5);
+      unpacked[4] = data[4] & 3;   // as if TXT_TYPE_PLAIN, so ack_hash matches what sender expects
+      len = 5 + TxtCompressor::decompress((char *) &unpacked[5], MAX_TEXT_LEN + 1, &data[5], len - 5);
+      data = unpacked;
+      flags = TXT_TYPE_PLAIN;
+    }
+
     if (flags == TXT_TYPE_PLAIN) {
       onMessageRecv(from, packet, timestamp, (const char *) &data[5]);  // let UI know
 
@@ -166,7 +235,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the ACK
         mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
-                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4, packet->getPayloadVer());
         if (path) sendFlood(path, TXT_ACK_DELAY);
       } else {
         sendAckTo(from, ack_hash);
@@ -177,7 +246,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect() (NOTE: no ACK as extra)
-        mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len, 0, NULL, 0);
+        mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len, 0, NULL, 0, packet->getPayloadVer());
         if (path) sendFlood(path);
       }
     } else if (flags == TXT_TYPE_SIGNED_PLAIN) {
@@ -192,7 +261,7 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the ACK
         mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
-                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4);
+                                                PAYLOAD_TYPE_ACK, (uint8_t *) &ack_hash, 4, packet->getPayloadVer());
         if (path) sendFlood(path, TXT_ACK_DELAY);
       } else {
         sendAckTo(from, ack_hash);
@@ -208,10 +277,10 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
       if (packet->isRouteFlood()) {
         // let this sender know path TO here, so they can use sendDirect(), and ALSO encode the response
         mesh::Packet* path = createPathReturn(from.id, secret, packet->path, packet->path_len,
-                                              PAYLOAD_TYPE_RESPONSE, temp_buf, reply_len);
+                                              PAYLOAD_TYPE_RESPONSE, temp_buf, reply_len, packet->getPayloadVer());
         if (path) sendFlood(path, SERVER_RESPONSE_DELAY);
       } else {
-        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, from.id, secret, temp_buf, reply_len);
+        mesh::Packet* reply = createDatagram(PAYLOAD_TYPE_RESPONSE, from.id, secret, temp_buf, reply_len, getPayloadVerFor(from));
         if (reply) {
           if (from.out_path_len >= 0) {  // we have an out_path, so send DIRECT
             sendDirect(reply, from.out_path, from.out_path_len, SERVER_RESPONSE_DELAY);
@@ -223,13 +292,15 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
     }
   } else if (type == PAYLOAD_TYPE_RESPONSE && len > 0) {
     onContactResponse(from, data, len);
+  } else if (type == PAYLOAD_TYPE_BULK && len > 0) {
+    onBulkDataRecv(from, data, len);
   }
 }
 
 bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
-  int i = matching_peer_indexes[sender_idx];
-  if (i < 0 || i >= num_contacts) {
-    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", i);
+  int i = resolvePeerSlot(matching_peer_indexes[sender_idx]);
+  if (i < 0) {
+    MESH_DEBUG_PRINTLN("onPeerPathRecv: Invalid sender idx: %d", matching_peer_indexes[sender_idx]);
     return false;
   }
 
@@ -238,6 +309,7 @@ bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const ui
   // NOTE: for this impl, we just replace the current 'out_path' regardless, whenever sender sends us a new out_path.
   // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
   memcpy(from.out_path, path, from.out_path_len = path_len);  // store a copy of path, for sendDirect()
+  from.out_path_ver = packet->getPayloadVer();   // size of hashes in path
   from.lastmod = getRTCClock()->getCurrentTime();
 
   onContactPathUpdated(from);
@@ -261,10 +333,10 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
 }
 
 #ifdef MAX_GROUP_CHANNELS
-int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel dest[], int max_matches) {
+int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, uint8_t hash_size, mesh::GroupChannel dest[], int max_matches) {
   int n = 0;
   for (int i = 0; i < MAX_GROUP_CHANNELS && n < max_matches; i++) {
-    if (channels[i].channel.hash[0] == hash[0]) {
+    if (memcmp(channels[i].channel.hash, hash, hash_size) == 0) {
       dest[n++] = channels[i].channel;
     }
   }
@@ -274,18 +346,33 @@ int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel d
 
 void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
   uint8_t txt_type = data[4];
-  if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (txt_type >> 2) == 0) {  // 0 = plain text msg
+  if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && ((txt_type >> 2) == TXT_TYPE_PLAIN || (txt_type >> 2) == TXT_TYPE_COMPRESSED)) {
     uint32_t timestamp;
     memcpy(&timestamp, data, 4);
 
     // len can be > original length, but 'text' will be padded with zeroes
     data[len] = 0; // need to make a C string again, with null terminator
 
+    const char* text = (const char *) &data[5];
+    char unpacked[MAX_TEXT_LEN + 32 + 1];
+    if ((txt_type >> 2) == TXT_TYPE_COMPRESSED) {
+      TxtCompressor::decompress(unpacked, sizeof(unpacked), &data[5], len - 5);
+      text = unpacked;
+    }
+
     // notify UI  of this new message
-    onChannelMessageRecv(channel, packet, timestamp, (const char *) &data[5]);  // let UI know
+    onChannelMessageRecv(channel, packet, timestamp, text);  // let UI know
   }
 }
 
+static uint8_t numPathHops(const ContactInfo& contact) {
+  return contact.out_path_len / mesh::Packet::getPathHashSizeFor(contact.out_path_ver);
+}
+
+static int numCipherBlocks(int len) {
+  return (len + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE;
+}
+
 mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack) {
   int text_len = strlen(text);
   if (text_len > MAX_TEXT_LEN) return NULL;
@@ -299,13 +386,31 @@ mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint3
   // calc expected ACK reply
   mesh::Utils::sha256((uint8_t *)&expected_ack, 4, temp, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
 
+  int tail = attempt > 3 ? 2 : 0;
+  if (isTextCompressionEnabled() && (recipient.adv_feat1 & ADV_FEAT1_TXT_COMPRESSED)) {   // only if they can decode it
+    uint8_t packed[5+MAX_TEXT_LEN+2];
+    int packed_len = TxtCompressor::compress(&packed[5], MAX_TEXT_LEN, text, text_len);
+    // only worth it if it saves at least one cipher block (ie. airtime)
+    if (packed_len > 0 && numCipherBlocks(5 + packed_len + tail) < numCipherBlocks(5 + text_len + tail)) {
+      memcpy(packed, temp, 4);
+      packed[4] = (attempt & 3) | (TXT_TYPE_COMPRESSED << 2);
+
+      int len = 5 + packed_len;
+      if (attempt > 3) {
+        packed[len++] = 0;  // null terminator
+        packed[len++] = attempt;  // hide attempt number at tail end of payload
+      }
+      return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), packed, len, getPayloadVerFor(recipient));
+    }
+  }
+
   int len = 5 + text_len;
   if (attempt > 3) {
     temp[len++] = 0;  // null terminator
     temp[len++] = attempt;  // hide attempt number at tail end of payload
   }
 
-  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.shared_secret, temp, len);
+  return createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, len, getPayloadVerFor(recipient));
 }
 
 int  BaseChatMesh::sendMessage(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char* text, uint32_t& expected_ack, uint32_t& est_timeout) {
@@ -321,7 +426,7 @@ int  BaseChatMesh::sendMessage(const ContactInfo& recipient, uint32_t timestamp,
     rc = MSG_SEND_SENT_FLOOD;
   } else {
     sendDirect(pkt, recipient.out_path, recipient.out_path_len);
-    txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len));
+    txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, numPathHops(recipient)));
     rc = MSG_SEND_SENT_DIRECT;
   }
   return rc;
@@ -336,7 +441,7 @@ int  BaseChatMesh::sendCommandData(const ContactInfo& recipient, uint32_t timest
   temp[4] = (attempt & 3) | (TXT_TYPE_CLI_DATA << 2);
   memcpy(&temp[5], text, text_len + 1);
 
-  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, recipient.shared_secret, temp, 5 + text_len);
+  auto pkt = createDatagram(PAYLOAD_TYPE_TXT_MSG, recipient.id, getSharedSecret(recipient), temp, 5 + text_len, getPayloadVerFor(recipient));
   if (pkt == NULL) return MSG_SEND_FAILED;
 
   uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -347,7 +452,7 @@ int  BaseChatMesh::sendCommandData(const ContactInfo& recipient, uint32_t timest
     rc = MSG_SEND_SENT_FLOOD;
   } else {
     sendDirect(pkt, recipient.out_path, recipient.out_path_len);
-    txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len));
+    txt_send_timeout = futureMillis(est_timeout = calcDirectTimeoutMillisFor(t, numPathHops(recipient)));
     rc = MSG_SEND_SENT_DIRECT;
   }
   return rc;
@@ -366,7 +471,10 @@ bool BaseChatMesh::sendGroupMessage(uint32_t timestamp, mesh::GroupChannel& chan
   memcpy(ep, text, text_len);
   ep[text_len] = 0;  // null terminator
 
-  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, 5 + prefix_len + text_len);
+  int len = 5 + prefix_len + text_len;
+  // NOTE: never sent compressed, as there is no way to know all channel members can decode it
+
+  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, len);
   if (pkt) {
     sendFlood(pkt);
     return true;
@@ -423,7 +531,7 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
       tlen = 4 + len;
     }
 
-    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, recipient.shared_secret, temp, tlen);
+    pkt = createAnonDatagram(PAYLOAD_TYPE_ANON_REQ, self_id, recipient.id, getSharedSecret(recipient), temp, tlen, getPayloadVerFor(recipient));
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -433,7 +541,7 @@ int BaseChatMesh::sendLogin(const ContactInfo& recipient, const char* password,
       return MSG_SEND_SENT_FLOOD;
     } else {
       sendDirect(pkt, recipient.out_path, recipient.out_path_len);
-      est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len);
+      est_timeout = calcDirectTimeoutMillisFor(t, numPathHops(recipient));
       return MSG_SEND_SENT_DIRECT;
     }
   }
@@ -450,7 +558,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, const uint8_t* req_
     memcpy(temp, &tag, 4);   // mostly an extra blob to help make packet_hash unique
     memcpy(&temp[4], req_data, data_len);
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.shared_secret, temp, 4 + data_len);
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, 4 + data_len, getPayloadVerFor(recipient));
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -460,7 +568,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, const uint8_t* req_
       return MSG_SEND_SENT_FLOOD;
     } else {
       sendDirect(pkt, recipient.out_path, recipient.out_path_len);
-      est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len);
+      est_timeout = calcDirectTimeoutMillisFor(t, numPathHops(recipient));
       return MSG_SEND_SENT_DIRECT;
     }
   }
@@ -477,7 +585,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, uint8_t req_type, u
     memset(&temp[5], 0, 4);  // reserved (possibly for 'since' param)
     getRNG()->random(&temp[9], 4);   // random blob to help make packet-hash unique
 
-    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, recipient.shared_secret, temp, sizeof(temp));
+    pkt = createDatagram(PAYLOAD_TYPE_REQ, recipient.id, getSharedSecret(recipient), temp, sizeof(temp), getPayloadVerFor(recipient));
   }
   if (pkt) {
     uint32_t t = _radio->getEstAirtimeFor(pkt->getRawLength());
@@ -487,7 +595,7 @@ int  BaseChatMesh::sendRequest(const ContactInfo& recipient, uint8_t req_type, u
       return MSG_SEND_SENT_FLOOD;
     } else {
       sendDirect(pkt, recipient.out_path, recipient.out_path_len);
-      est_timeout = calcDirectTimeoutMillisFor(t, recipient.out_path_len);
+      est_timeout = calcDirectTimeoutMillisFor(t, numPathHops(recipient));
       return MSG_SEND_SENT_DIRECT;
     }
   }
@@ -598,13 +706,15 @@ void BaseChatMesh::checkConnections() {
       // calc expected ACK reply
       mesh::Utils::sha256((uint8_t *)&connections[i].expected_ack, 4, data, 9, self_id.pub_key, PUB_KEY_SIZE);
 
-      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, contact->shared_secret, data, 9);
+      auto pkt = createDatagram(PAYLOAD_TYPE_REQ, contact->id, getSharedSecret(*contact), data, 9, getPayloadVerFor(*contact));
       if (pkt) {
         sendDirect(pkt, contact->out_path, contact->out_path_len);
       }
     
-      // schedule next KEEP_ALIVE
-      connections[i].next_ping = futureMillis(connections[i].keep_alive_millis);
+      // schedule next KEEP_ALIVE (back-off when channel is busy, but well within the 2.5 x expiry)
+      uint32_t interval = stretchForChannelLoad(connections[i].keep_alive_millis);
+      if (interval > connections[i].keep_alive_millis*2) interval = connections[i].keep_alive_millis*2;
+      connections[i].next_ping = futureMillis(interval);
     }
   }
 }
@@ -613,79 +723,345 @@ void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = -1;
 }
 
-static ContactInfo* table;  // pass via global :-(
+void BaseChatMesh::updateContactIndexes(const ContactInfo& contact) {
+  if (&contact >= contacts && &contact < &contacts[MAX_CONTACTS]) {
+    int slot = &contact - contacts;
+    recent.update(slot, contact.last_advert_timestamp);
+    unindexName(slot);
+    indexName(slot);
+  }
+}
+
+void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
+  if (last_n == 0) last_n = getNumContacts();   // scan ALL
+
+  int s = recent.first();
+#ifdef MAX_COLD_CONTACTS
+  int c = cold_recent.first();   // merge the hot and cold lists
+  while (last_n > 0 && (s >= 0 || c >= 0)) {
+    if (c >= 0 && (s < 0 || cold_recent.keyOf(c) > recent.keyOf(s))) {
+      ContactInfo tmp;   // visit a copy, without paging it in
+      if (readColdContact(c, tmp)) {
+        visitor->onContactVisit(tmp);
+        last_n--;
+      }
+      c = cold_recent.next(c);
+    } else {
+      visitor->onContactVisit(contacts[s]);
+      last_n--;
+      s = recent.next(s);
+    }
+  }
+#else
+  for ( ; s >= 0 && last_n > 0; s = recent.next(s), last_n--) {
+    visitor->onContactVisit(contacts[s]);
+  }
+#endif
+}
 
-static int cmp_adv_timestamp(const void *a, const void *b) {
-  int a_idx = *((int *)a);
-  int b_idx = *((int *)b);
-  if (table[b_idx].last_advert_timestamp > table[a_idx].last_advert_timestamp) return 1;
-  if (table[b_idx].last_advert_timestamp < table[a_idx].last_advert_timestamp) return -1;
+static int cmpNameNoCase(const char* a, const char* b, int max_len) {
+  for (int i = 0; i < max_len; i++) {
+    int ca = tolower((uint8_t) a[i]);
+    int cb = tolower((uint8_t) b[i]);
+    if (ca != cb) return ca - cb;
+    if (ca == 0) break;
+  }
   return 0;
 }
 
-void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
-  for (int i = 0; i < num_contacts; i++) {  // sort the INDEXES into contacts[]
-    sort_array[i] = i;
+int BaseChatMesh::findNamePos(const char* name) const {   // ie. lower bound, in name_order[]
+  int lo = 0, hi = num_names;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (cmpNameNoCase(contacts[name_order[mid]].name, name, sizeof(contacts[0].name)) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
   }
-  table = contacts; // pass via global *sigh* :-(
-  qsort(sort_array, num_contacts, sizeof(sort_array[0]), cmp_adv_timestamp);
+  return lo;
+}
 
-  if (last_n == 0) {
-    last_n = num_contacts;   // scan ALL
-  } else {
-    if (last_n > num_contacts) last_n = num_contacts;
+void BaseChatMesh::indexName(int slot) {
+  int pos = findNamePos(contacts[slot].name);
+  memmove(&name_order[pos + 1], &name_order[pos], (num_names - pos) * sizeof(name_order[0]));
+  name_order[pos] = slot;
+  num_names++;
+}
+
+void BaseChatMesh::unindexName(int slot) {
+  for (int i = 0; i < num_names; i++) {   // NOTE: name may have already been changed, so can't search by it
+    if (name_order[i] == slot) {
+      num_names--;
+      memmove(&name_order[i], &name_order[i + 1], (num_names - i) * sizeof(name_order[0]));
+      return;
+    }
+  }
+}
+
+int BaseChatMesh::searchContactsByName(const char* name_prefix, ContactVisitor* visitor, int max_matches, int skip) {
+  int len = strlen(name_prefix);
+  int start = findNamePos(name_prefix);
+  int end = start;
+  while (end < num_names && cmpNameNoCase(contacts[name_order[end]].name, name_prefix, len) == 0) end++;
+
+  int n = 0;
+  for (int i = start + skip; i < end && n < max_matches; i++, n++) {
+    visitor->onContactVisit(contacts[name_order[i]]);
   }
-  for (int i = 0; i < last_n; i++) {
-    visitor->onContactVisit(contacts[sort_array[i]]);
+#ifdef MAX_COLD_CONTACTS
+  skip -= end - start;   // hot matches come first, then the cold ones
+  for (int i = 0; i < cold_idx.count() && n < max_matches; i++) {   // NOTE: reads each from storage
+    ContactInfo c;   // visit a copy, without paging it in
+    if (readColdContact(cold_idx.slotAt(i), c) && cmpNameNoCase(c.name, name_prefix, len) == 0) {
+      if (skip > 0) {
+        skip--;
+      } else {
+        visitor->onContactVisit(c);
+        n++;
+      }
+    }
   }
+#endif
+  return n;
 }
 
 ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
   int len = strlen(name_prefix);
-  for (int i = 0; i < num_contacts; i++) {
-    auto c = &contacts[i];
-    if (memcmp(c->name, name_prefix, len) == 0) return c;
+  for (int i = findNamePos(name_prefix); i < num_names; i++) {
+    auto c = &contacts[name_order[i]];
+    if (cmpNameNoCase(c->name, name_prefix, len) != 0) break;   // past the case-insensitive matches
+    if (memcmp(c->name, name_prefix, len) == 0) {
+    #ifdef MAX_COLD_CONTACTS
+      touchContact(name_order[i]);
+    #endif
+      return c;
+    }
+  }
+#ifdef MAX_COLD_CONTACTS
+  for (int i = 0; i < cold_idx.count(); i++) {   // NOTE: reads each from storage
+    ContactInfo c;
+    int cold = cold_idx.slotAt(i);
+    if (readColdContact(cold, c) && memcmp(c.name, name_prefix, len) == 0) {
+      int slot = pageInContact(cold);
+      return slot >= 0 ? &contacts[slot] : NULL;
+    }
   }
+#endif
   return NULL;  // not found
 }
 
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
-  for (int i = 0; i < num_contacts; i++) {
+  if (prefix_len <= 0) {
+    return contact_idx.count() > 0 ? &contacts[contact_idx.slotAt(0)] : NULL;   // everything matches
+  }
+  for (int i = contact_idx.first(pub_key[0]); i >= 0; i = contact_idx.next(i)) {
     auto c = &contacts[i];
-    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
+    if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) {
+    #ifdef MAX_COLD_CONTACTS
+      touchContact(i);
+    #endif
+      return c;
+    }
+  }
+#ifdef MAX_COLD_CONTACTS
+  int cold = findColdContact(pub_key, prefix_len);
+  if (cold >= 0) {
+    int slot = pageInContact(cold);
+    if (slot >= 0) return &contacts[slot];
   }
+#endif
   return NULL;  // not found
 }
 
-bool BaseChatMesh::addContact(const ContactInfo& contact) {
-  if (num_contacts < MAX_CONTACTS) {
-    auto dest = &contacts[num_contacts++];
-    *dest = contact;
+bool BaseChatMesh::hasContact(const uint8_t* pub_key, int prefix_len) {
+  if (prefix_len <= 0) return contact_idx.count() > 0;
 
-    // calc the ECDH shared secret (just once for performance)
-    self_id.calcSharedSecret(dest->shared_secret, contact.id);
+  for (int i = contact_idx.first(pub_key[0]); i >= 0; i = contact_idx.next(i)) {
+    if (memcmp(contacts[i].id.pub_key, pub_key, prefix_len) == 0) return true;
+  }
+#ifdef MAX_COLD_CONTACTS
+  int len = prefix_len < COLD_KEY_PREFIX_LEN ? prefix_len : COLD_KEY_PREFIX_LEN;
+  for (int i = cold_idx.first(pub_key[0]); i >= 0; i = cold_idx.next(i)) {
+    if (memcmp(cold_prefix[i], pub_key, len) == 0) return true;
+  }
+#endif
+  return false;
+}
 
+bool BaseChatMesh::addContact(const ContactInfo& contact) {
+  int slot = allocContact(contact.id, contact.last_advert_timestamp);
+  if (slot >= 0) {
+    contacts[slot] = contact;   // NOTE: shared_secret is calculated on first use, or by warmUpSharedSecrets()
+    indexName(slot);
     return true;  // success
   }
   return false;
 }
 
+int BaseChatMesh::allocContact(const mesh::Identity& id, uint32_t last_advert_timestamp) {
+  int slot = contact_idx.alloc(id.pub_key[0]);
+#ifdef MAX_COLD_CONTACTS
+  if (slot < 0 && pageOutContact()) slot = contact_idx.alloc(id.pub_key[0]);
+  if (slot >= 0) touchContact(slot);
+#endif
+  if (slot >= 0) {
+    recent.insert(slot, last_advert_timestamp);
+    secret_ready[slot >> 3] &= ~(1 << (slot & 7));
+    secret_warmup_idx = 0;  // rescan
+  }
+  return slot;
+}
+
+void BaseChatMesh::ensureSharedSecret(int slot) {
+  if ((secret_ready[slot >> 3] & (1 << (slot & 7))) == 0) {
+    self_id.calcSharedSecret(contacts[slot].shared_secret, contacts[slot].id);   // ECDH is slow, so only do once per contact
+    secret_ready[slot >> 3] |= (1 << (slot & 7));
+  }
+}
+
+const uint8_t* BaseChatMesh::getSharedSecret(const ContactInfo& contact) {
+  if (&contact >= contacts && &contact < &contacts[MAX_CONTACTS]) {
+    int slot = &contact - contacts;
+    ensureSharedSecret(slot);
+    return contacts[slot].shared_secret;
+  }
+  self_id.calcSharedSecret(temp_secret, contact.id);   // not one of our contacts[] (ie. a copy)
+  return temp_secret;
+}
+
+void BaseChatMesh::warmUpSharedSecrets() {
+  // calc secrets not used yet, one at a time, so boot (ie. loading contacts) doesn't have to wait for them all
+  while (secret_warmup_idx < contact_idx.count() && millisHasNowPassed(next_secret_warmup)) {
+    int slot = contact_idx.slotAt(secret_warmup_idx++);
+    if ((secret_ready[slot >> 3] & (1 << (slot & 7))) == 0) {
+      ensureSharedSecret(slot);
+      next_secret_warmup = futureMillis(SECRET_WARMUP_INTERVAL);
+    }
+  }
+#ifdef MAX_COLD_CONTACTS
+  // then the cold contacts (needs a storage read each)
+  while (secret_warmup_idx >= contact_idx.count() && secret_warmup_idx < contact_idx.count() + cold_idx.count()
+          && millisHasNowPassed(next_secret_warmup)) {
+    int cold = cold_idx.slotAt(secret_warmup_idx++ - contact_idx.count());
+    if (!isColdSecretReady(cold)) {
+      calcColdSecret(cold);
+      next_secret_warmup = futureMillis(SECRET_WARMUP_INTERVAL);
+    }
+  }
+#endif
+}
+
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
+  uint8_t hash = contact.id.pub_key[0];
+  int slot = contact_idx.first(hash);
+  while (slot >= 0 && !contacts[slot].id.matches(contact.id)) {
+    slot = contact_idx.next(slot);
+  }
+  if (slot >= 0) {
+    contact_idx.free(slot, hash);   // NOTE: other contacts stay in their slots
+    recent.remove(slot);
+    unindexName(slot);
+    return true;  // Success
+  }
+#ifdef MAX_COLD_CONTACTS
+  int cold = findColdContact(contact.id.pub_key, PUB_KEY_SIZE);
+  if (cold >= 0) {
+    cold_idx.free(cold, hash);   // its record in storage is just left to be overwritten
+    cold_recent.remove(cold);
+    return true;
+  }
+#endif
+  return false;   // not found
+}
+
+#ifdef MAX_COLD_CONTACTS
+bool BaseChatMesh::pageOutContact() {
+  int lru = -1;
+  for (int i = 0; i < contact_idx.count(); i++) {
+    int s = contact_idx.slotAt(i);
+    if ((int32_t)(hot_used[s] - hot_pin_tick) > 0) continue;   // used in this loop(), caller may hold a ContactInfo*
+    if (lru < 0 || (int32_t)(hot_used[s] - hot_used[lru]) < 0) lru = s;
+  }
+  if (lru < 0) {
+    MESH_DEBUG_PRINTLN("pageOutContact: all hot contacts are pinned");
+    return false;
   }
-  if (idx >= num_contacts) return false;   // not found
 
-  // remove from contacts array
-  num_contacts--;
-  while (idx < num_contacts) {
-    contacts[idx] = contacts[idx + 1];
-    idx++;
+  ContactInfo& c = contacts[lru];
+  uint8_t hash = c.id.pub_key[0];
+  int cold = cold_idx.alloc(hash);
+  if (cold < 0) {
+    MESH_DEBUG_PRINTLN("pageOutContact: cold store is full!");
+    return false;
   }
-  return true;  // Success
+  if (!writeColdContact(cold, c)) {
+    cold_idx.free(cold, hash);
+    return false;
+  }
+  memcpy(cold_prefix[cold], c.id.pub_key, COLD_KEY_PREFIX_LEN);
+  if (secret_ready[lru >> 3] & (1 << (lru & 7))) {
+    memcpy(cold_secret[cold], c.shared_secret, PUB_KEY_SIZE);
+    cold_secret_ready[cold >> 3] |= (1 << (cold & 7));
+  } else {
+    cold_secret_ready[cold >> 3] &= ~(1 << (cold & 7));   // warmUpSharedSecrets() will get to it
+    secret_warmup_idx = 0;
+  }
+  cold_lastmod[cold] = c.lastmod;
+  cold_recent.insert(cold, c.last_advert_timestamp);
+
+  contact_idx.free(lru, hash);
+  recent.remove(lru);
+  unindexName(lru);
+  return true;
 }
 
+int BaseChatMesh::pageInContact(int cold_slot) {
+  ContactInfo c;
+  if (!cold_idx.isUsed(cold_slot) || !readColdContact(cold_slot, c)) return -1;
+  bool has_secret = isColdSecretReady(cold_slot);
+  if (has_secret) memcpy(c.shared_secret, cold_secret[cold_slot], PUB_KEY_SIZE);   // cold_slot may get reused below
+
+  uint8_t hash = c.id.pub_key[0];
+  cold_idx.free(cold_slot, hash);   // so the contact being paged out can take its place
+  cold_recent.remove(cold_slot);
+  int slot = allocContact(c.id, c.last_advert_timestamp);
+  if (slot < 0) {
+    cold_idx.alloc(hash);   // undo, gets same cold_slot back
+    cold_recent.insert(cold_slot, c.last_advert_timestamp);
+    MESH_DEBUG_PRINTLN("pageInContact: unable to page out a hot contact");
+    return -1;
+  }
+  contacts[slot] = c;
+  indexName(slot);
+  if (has_secret) {
+    secret_ready[slot >> 3] |= (1 << (slot & 7));
+  }
+  return slot;
+}
+
+bool BaseChatMesh::calcColdSecret(int cold_slot) {
+  ContactInfo c;
+  if (!readColdContact(cold_slot, c)) return false;
+
+  self_id.calcSharedSecret(cold_secret[cold_slot], c.id);   // ECDH is slow, so only do once per contact
+  cold_secret_ready[cold_slot >> 3] |= (1 << (cold_slot & 7));
+  return true;
+}
+
+int BaseChatMesh::findColdContact(const uint8_t* pub_key, int prefix_len) {
+  int len = prefix_len < COLD_KEY_PREFIX_LEN ? prefix_len : COLD_KEY_PREFIX_LEN;
+  for (int i = cold_idx.first(pub_key[0]); i >= 0; i = cold_idx.next(i)) {
+    if (memcmp(cold_prefix[i], pub_key, len) != 0) continue;
+    if (prefix_len <= COLD_KEY_PREFIX_LEN) return i;
+
+    ContactInfo c;   // need the full pub_key, from storage
+    if (readColdContact(i, c) && memcmp(c.id.pub_key, pub_key, prefix_len) == 0) return i;
+  }
+  return -1;  // not found
+}
+#endif
+
 #ifdef MAX_GROUP_CHANNELS
 #include <base64.hpp>
 
@@ -746,11 +1122,24 @@ int BaseChatMesh::findChannelIdx(const mesh::GroupChannel& ch) {
 }
 #endif
 
-bool BaseChatMesh::getContactByIdx(uint32_t idx, ContactInfo& contact) {
-  if (idx >= num_contacts) return false;
+int BaseChatMesh::getNumContacts() const {
+#ifdef MAX_COLD_CONTACTS
+  return contact_idx.count() + cold_idx.count();
+#else
+  return contact_idx.count();
+#endif
+}
 
-  contact = contacts[idx];
-  return true;
+bool BaseChatMesh::getContactByIdx(uint32_t idx, ContactInfo& contact) const {
+  if (idx < contact_idx.count()) {
+    contact = contacts[contact_idx.slotAt(idx)];
+    return true;
+  }
+#ifdef MAX_COLD_CONTACTS
+  idx -= contact_idx.count();   // cold contacts follow the hot ones
+  if (idx < cold_idx.count()) return readColdContact(cold_idx.slotAt(idx), contact);
+#endif
+  return false;
 }
 
 ContactsIterator BaseChatMesh::startContactsIterator() {
@@ -758,15 +1147,162 @@ ContactsIterator BaseChatMesh::startContactsIterator() {
 }
 
 bool ContactsIterator::hasNext(const BaseChatMesh* mesh, ContactInfo& dest) {
-  if (next_idx >= mesh->getNumContacts()) return false;
+  if (!mesh->getContactByIdx(next_idx, dest)) return false;
 
-  dest = mesh->contacts[next_idx++];
+  next_idx++;
   return true;
 }
 
+uint32_t BaseChatMesh::getBulkFragAirtime(const ContactInfo& contact) {
+  return _radio->getEstAirtimeFor(2 + contact.out_path_len + MAX_PACKET_PAYLOAD);
+}
+
+bool BaseChatMesh::startBulkSend(const ContactInfo& recipient, const uint8_t* data, int len) {
+  if (bulk_sender.isActive() || recipient.out_path_len < 0) return false;   // busy, or no direct route known
+
+  uint16_t xfer_id;
+  getRNG()->random((uint8_t *) &xfer_id, 2);
+  uint32_t t = getBulkFragAirtime(recipient);
+  if (!bulk_sender.begin(xfer_id, data, len, calcDirectTimeoutMillisFor(t, numPathHops(recipient)), t, _ms->getMillis())) {
+    return false;
+  }
+  bulk_send_to = recipient.id;
+  bulk_send_slot = -1;
+  bulk_send_pending = true;
+  return true;
+}
+
+void BaseChatMesh::cancelBulkSend() {
+  if (!bulk_sender.isActive()) return;
+
+  bulk_sender.cancel();
+  sendBulkCancel(getBulkPeer(bulk_send_slot, bulk_send_to));
+}
+
+void BaseChatMesh::sendBulkCancel(const ContactInfo* to) {   // let receiver know
+  uint8_t data[3];
+  int len = bulk_sender.writeCancel(data);
+  mesh::Packet* pkt;
+  if (to) {
+    pkt = createDatagram(PAYLOAD_TYPE_BULK, to->id, getSharedSecret(*to), data, len, getPayloadVerFor(*to));
+  } else {   // contact was removed, so no cached secret (or path)
+    uint8_t secret[PUB_KEY_SIZE];
+    self_id.calcSharedSecret(secret, bulk_send_to);
+    pkt = createDatagram(PAYLOAD_TYPE_BULK, bulk_send_to, secret, data, len, PAYLOAD_VER_1);
+  }
+  if (pkt == NULL) return;
+
+  if (to && to->out_path_len >= 0) {
+    sendDirect(pkt, to->out_path, to->out_path_len);
+  } else {
+    sendFlood(pkt);
+  }
+}
+
+ContactInfo* BaseChatMesh::getBulkPeer(int& slot, const mesh::Identity& id) {
+  if (!(contact_idx.isUsed(slot) && contacts[slot].id.matches(id))) {   // not resolved yet, or removed/paged out since
+    ContactInfo* c = lookupContactByPubKey(id.pub_key, PUB_KEY_SIZE);
+    slot = c ? c - contacts : -1;
+  }
+#ifdef MAX_COLD_CONTACTS
+  if (slot >= 0) touchContact(slot);
+#endif
+  return slot >= 0 ? &contacts[slot] : NULL;
+}
+
+void BaseChatMesh::onBulkDataRecv(const ContactInfo& from, const uint8_t* data, size_t len) {
+  unsigned long now = _ms->getMillis();
+  if (data[0] == BULK_KIND_SACK) {
+    if (bulk_sender.isActive() && from.id.matches(bulk_send_to)) {
+      bulk_sender.onSack(data, len, now);
+    }
+    return;
+  }
+  if (data[0] == BULK_KIND_CANCEL) {
+    if (from.id.matches(bulk_recv_from) && bulk_recv.isCancel(data, len)) {
+      bulk_recv.reset();
+    }
+    if (bulk_sender.isActive() && from.id.matches(bulk_send_to)) {
+      bulk_sender.onCancel(data, len);
+    }
+    return;
+  }
+  if (data[0] != BULK_KIND_DATA || len < BULK_DATA_HDR_SIZE) return;   // unknown kind, or truncated
+
+  bool same_sender = from.id.matches(bulk_recv_from);
+  if (!same_sender || bulk_recv.isNewTransfer(data, len)) {
+    if (!same_sender && bulk_recv.isActive() && !bulk_recv.isStale(now, BULK_RECV_TIMEOUT)) return;   // busy with another contact
+    if (from.out_path_len < 0) return;   // need a direct route back, for SACKs
+
+    int buf_sz = 0;
+    uint8_t* buf = getBulkRecvBuffer(from, buf_sz);
+    if (buf == NULL) return;   // not accepted
+
+    if (!BulkReceiver::isAcceptable(data, len, buf_sz)) {   // too big, so tell sender to give up now
+      uint8_t cancel[3];
+      cancel[0] = BULK_KIND_CANCEL;
+      memcpy(&cancel[1], &data[1], 2);   // their xfer_id
+      auto pkt = createDatagram(PAYLOAD_TYPE_BULK, from.id, getSharedSecret(from), cancel, sizeof(cancel), getPayloadVerFor(from));
+      if (pkt) sendDirect(pkt, from.out_path, from.out_path_len);
+      return;
+    }
+
+    uint16_t xfer_id;
+    memcpy(&xfer_id, &data[1], 2);
+    bulk_recv.begin(xfer_id, buf, buf_sz, getBulkFragAirtime(from) * (BULK_PACING_FACTOR + 1), now);
+    bulk_recv_from = from.id;
+    bulk_recv_slot = -1;
+  }
+  if (bulk_recv.onFragment(data, len, now) == 1) {
+    onBulkRecv(from, bulk_recv.getData(), bulk_recv.getLength());
+  }
+}
+
+void BaseChatMesh::checkBulkTransfers() {
+  unsigned long now = _ms->getMillis();
+
+  if (bulk_send_pending) {
+    ContactInfo* to = getBulkPeer(bulk_send_slot, bulk_send_to);
+    if (bulk_sender.isActive() && (to == NULL || to->out_path_len < 0)) {
+      bulk_sender.cancel();   // contact was removed, or path was reset
+      sendBulkCancel(to);
+    }
+    if (bulk_sender.isActive()) {
+      uint8_t frag[BULK_DATA_HDR_SIZE + BULK_MAX_FRAG_DATA];
+      int len = bulk_sender.nextFragment(frag, now);
+      if (len > 0) {
+        auto pkt = createDatagram(PAYLOAD_TYPE_BULK, to->id, getSharedSecret(*to), frag, len, getPayloadVerFor(*to));
+        if (pkt) sendDirect(pkt, to->out_path, to->out_path_len);
+      }
+    }
+    if (!bulk_sender.isActive()) {   // finished, failed, or cancelled
+      bulk_send_pending = false;
+      MESH_DEBUG_PRINTLN("bulk send %s: %d bytes/sec, retransmits=%d", bulk_sender.isDone() ? "done" : "failed",
+                          bulk_sender.getGoodput(), (uint32_t) bulk_sender.getNumRetransmits());
+      onBulkSendComplete(bulk_send_to, bulk_sender.isDone());
+    }
+  }
+
+  if (bulk_recv.isSackDue(now)) {
+    ContactInfo* from = getBulkPeer(bulk_recv_slot, bulk_recv_from);
+    uint8_t data[BULK_SACK_SIZE];
+    int len = bulk_recv.writeSack(data);
+    if (from && from->out_path_len >= 0) {
+      auto pkt = createDatagram(PAYLOAD_TYPE_BULK, from->id, getSharedSecret(*from), data, len, getPayloadVerFor(*from));
+      if (pkt) sendDirect(pkt, from->out_path, from->out_path_len);
+    }
+  }
+}
+
 void BaseChatMesh::loop() {
+#ifdef MAX_COLD_CONTACTS
+  hot_pin_tick = hot_tick;   // ContactInfo* handed out before now can be invalidated by paging
+#endif
   Mesh::loop();
 
+  checkBulkTransfers();
+  warmUpSharedSecrets();
+
   if (txt_send_timeout && millisHasNowPassed(txt_send_timeout)) {
     // failed to get an ACK
     onSendTimeout();
@@ -4,12 +4,22 @@
 #include <Mesh.h>
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/TxtDataHelpers.h>
+#include <helpers/TxtCompressor.h>
+#include <helpers/BulkTransfer.h>
+#include <helpers/ContactIndex.h>
+#include <helpers/RecencyList.h>
 
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
 #include "ContactInfo.h"
 
-#define MAX_SEARCH_RESULTS   8
+#ifndef MAX_SEARCH_RESULTS
+  #ifdef MAX_COLD_CONTACTS
+    #define MAX_SEARCH_RESULTS   (8 + (MAX_CONTACTS + MAX_COLD_CONTACTS) / 128)   // ~2x the average hash bucket
+  #else
+    #define MAX_SEARCH_RESULTS   8
+  #endif
+#endif
 
 #define MSG_SEND_FAILED       0
 #define MSG_SEND_SENT_FLOOD   1
@@ -37,6 +47,17 @@ public:
   #define MAX_CONTACTS  32
 #endif
 
+#ifdef MAX_COLD_CONTACTS
+  #define COLD_KEY_PREFIX_LEN   6   // bytes of pub_key kept in RAM, per cold contact
+  #ifndef COLD_SECRET_CALCS_PER_PACKET
+    #define COLD_SECRET_CALCS_PER_PACKET   1   // max storage reads + ECDH, for cold contacts not warmed up yet
+  #endif
+#endif
+
+#ifndef SECRET_WARMUP_INTERVAL
+  #define SECRET_WARMUP_INTERVAL  20   // millis between background shared_secret calcs (after boot)
+#endif
+
 #ifndef MAX_CONNECTIONS
   #define MAX_CONNECTIONS  16
 #endif
@@ -58,10 +79,29 @@ class BaseChatMesh : public mesh::Mesh {
 
   friend class ContactsIterator;
 
-  ContactInfo contacts[MAX_CONTACTS];
-  int num_contacts;
-  int sort_array[MAX_CONTACTS];
-  int matching_peer_indexes[MAX_SEARCH_RESULTS];
+  ContactInfo contacts[MAX_CONTACTS];   // by slot, see contact_idx
+  ContactIndex<MAX_CONTACTS> contact_idx;
+  RecencyList<MAX_CONTACTS> recent;   // slots, by last_advert_timestamp
+  uint16_t name_order[MAX_CONTACTS];   // slots, sorted by name (case-insensitive)
+  int num_names;
+  uint8_t secret_ready[(MAX_CONTACTS + 7) / 8];   // by slot, whether shared_secret has been calculated yet
+  uint8_t temp_secret[PUB_KEY_SIZE];
+  int secret_warmup_idx;
+  unsigned long next_secret_warmup;
+#ifdef MAX_COLD_CONTACTS
+  // contacts[] is the 'hot' set. When full, least recently used are paged out to storage (see writeColdContact())
+  uint32_t hot_used[MAX_CONTACTS];   // by slot, LRU tick
+  uint32_t hot_tick;
+  uint32_t hot_pin_tick;   // slots used since this tick (ie. in this loop()) are not paged out
+  ContactIndex<MAX_COLD_CONTACTS> cold_idx;   // cold slot is also the record number in storage
+  uint8_t  cold_prefix[MAX_COLD_CONTACTS][COLD_KEY_PREFIX_LEN];
+  uint8_t  cold_secret[MAX_COLD_CONTACTS][PUB_KEY_SIZE];   // so MAC checks don't need storage reads
+  uint8_t  cold_secret_ready[(MAX_COLD_CONTACTS + 7) / 8];
+  int cold_calcs_left;   // per packet, see COLD_SECRET_CALCS_PER_PACKET
+  uint32_t cold_lastmod[MAX_COLD_CONTACTS];
+  RecencyList<MAX_COLD_CONTACTS> cold_recent;
+#endif
+  int matching_peer_indexes[MAX_SEARCH_RESULTS];   // slots (or -1 - cold slot)
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
   ChannelDetails channels[MAX_GROUP_CHANNELS];
@@ -70,15 +110,42 @@ class BaseChatMesh : public mesh::Mesh {
   mesh::Packet* _pendingLoopback;
   uint8_t temp_buf[MAX_TRANS_UNIT];
   ConnectionInfo connections[MAX_CONNECTIONS];
+  BulkSender bulk_sender;
+  mesh::Identity bulk_send_to;
+  int bulk_send_slot;   // cached contact slot for bulk_send_to (-1 = not resolved yet)
+  bool bulk_send_pending;
+  BulkReceiver bulk_recv;
+  mesh::Identity bulk_recv_from;
+  int bulk_recv_slot;
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
+  uint32_t getBulkFragAirtime(const ContactInfo& contact);
+  void onBulkDataRecv(const ContactInfo& from, const uint8_t* data, size_t len);
+  void checkBulkTransfers();
+  void sendBulkCancel(const ContactInfo* to);
+  ContactInfo* getBulkPeer(int& slot, const mesh::Identity& id);
+  int  allocContact(const mesh::Identity& id, uint32_t last_advert_timestamp);
+  void ensureSharedSecret(int slot);
+  const uint8_t* getSharedSecret(const ContactInfo& contact);
+  void warmUpSharedSecrets();
+  int  resolvePeerSlot(int i);
+  int  findNamePos(const char* name) const;
+  void indexName(int slot);
+  void unindexName(int slot);
+#ifdef MAX_COLD_CONTACTS
+  void touchContact(int slot) { hot_used[slot] = ++hot_tick; }
+  bool isColdSecretReady(int cold_slot) const { return cold_secret_ready[cold_slot >> 3] & (1 << (cold_slot & 7)); }
+  bool calcColdSecret(int cold_slot);
+  bool pageOutContact();
+  int  pageInContact(int cold_slot);
+  int  findColdContact(const uint8_t* pub_key, int prefix_len);
+#endif
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
       : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
   { 
-    num_contacts = 0;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -86,10 +153,24 @@ protected:
     txt_send_timeout = 0;
     _pendingLoopback = NULL;
     memset(connections, 0, sizeof(connections));
+    bulk_send_pending = false;
+    bulk_send_slot = bulk_recv_slot = -1;
+    memset(secret_ready, 0, sizeof(secret_ready));
+    secret_warmup_idx = 0;
+    next_secret_warmup = 0;
+    num_names = 0;
+  #ifdef MAX_COLD_CONTACTS
+    memset(hot_used, 0, sizeof(hot_used));
+    hot_tick = hot_pin_tick = 0;
+    memset(cold_secret_ready, 0, sizeof(cold_secret_ready));
+    cold_calcs_left = 0;
+  #endif
   }
 
   // 'UI' concepts, for sub-classes to implement
   virtual bool isAutoAddEnabled() const { return true; }
+  virtual bool isTextCompressionEnabled() const { return false; }   // opt-in, and only to contacts advertising ADV_FEAT1_TXT_COMPRESSED
+  virtual bool isPayloadV2Enabled() const { return false; }   // opt-in, until most repeaters can route PAYLOAD_VER_2
   virtual void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) = 0;
   virtual bool processAck(const uint8_t *data) = 0;
   virtual void onContactPathUpdated(const ContactInfo& contact) = 0;
@@ -102,23 +183,30 @@ protected:
   virtual void onChannelMessageRecv(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t timestamp, const char *text) = 0;
   virtual uint8_t onContactRequest(const ContactInfo& contact, uint32_t sender_timestamp, const uint8_t* data, uint8_t len, uint8_t* reply) = 0;
   virtual void onContactResponse(const ContactInfo& contact, const uint8_t* data, uint8_t len) = 0;
+  virtual uint8_t* getBulkRecvBuffer(const ContactInfo& from, int& buf_sz) { return NULL; }   // bulk receive not supported
+  virtual void onBulkRecv(const ContactInfo& from, const uint8_t* data, int len) { }
+  virtual void onBulkSendComplete(const mesh::Identity& recipient, bool success) { }   // NOTE: recipient may have been removed by now
 
   // storage concepts, for sub-classes to override/implement
   virtual int  getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) { return 0; }  // not implemented
   virtual bool putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) { return false; }
+  virtual bool writeColdContact(int cold_slot, const ContactInfo& contact) { return false; }  // for MAX_COLD_CONTACTS, paging not supported
+  virtual bool readColdContact(int cold_slot, ContactInfo& dest) const { return false; }
 
   // Mesh overrides
   void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
-  int searchPeersByHash(const uint8_t* hash) override;
+  int searchPeersByHash(const uint8_t* hash, uint8_t hash_size) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
   bool onPeerPathRecv(mesh::Packet* packet, int sender_idx, const uint8_t* secret, uint8_t* path, uint8_t path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) override;
   void onAckRecv(mesh::Packet* packet, uint32_t ack_crc) override;
 #ifdef MAX_GROUP_CHANNELS
-  int searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) override;
+  int searchChannelsByHash(const uint8_t* hash, uint8_t hash_size, mesh::GroupChannel channels[], int max_matches) override;
 #endif
   void onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) override;
 
+  uint8_t getPayloadVerFor(const ContactInfo& contact) const;
+
   // Connections
   bool startConnection(const ContactInfo& contact, uint16_t keep_alive_secs);
   void stopConnection(const uint8_t* pub_key);
@@ -136,17 +224,36 @@ public:
   int  sendLogin(const ContactInfo& recipient, const char* password, uint32_t& est_timeout);
   int  sendRequest(const ContactInfo& recipient, uint8_t req_type, uint32_t& tag, uint32_t& est_timeout);
   int  sendRequest(const ContactInfo& recipient, const uint8_t* req_data, uint8_t data_len, uint32_t& tag, uint32_t& est_timeout);
+  bool startBulkSend(const ContactInfo& recipient, const uint8_t* data, int len);  // NOTE: 'data' must remain valid until onBulkSendComplete()
+  void cancelBulkSend();
+  const BulkSender& getBulkSender() const { return bulk_sender; }
   bool shareContactZeroHop(const ContactInfo& contact);
   uint8_t exportContact(const ContactInfo& contact, uint8_t dest_buf[]);
   bool importContact(const uint8_t src_buf[], uint8_t len);
   void resetPathTo(ContactInfo& recipient);
+  void updateContactIndexes(const ContactInfo& contact);   // after changing contact.name or last_advert_timestamp directly
   void scanRecentContacts(int last_n, ContactVisitor* visitor);
+
+  /*
+   * NOTE: with MAX_COLD_CONTACTS, the lookup/search methods may page contacts in and out. The ContactInfo* they
+   * return stay valid until the next loop(), after that the slot may be reused by another contact.
+   */
   ContactInfo* searchContactsByPrefix(const char* name_prefix);
+
+  /**
+   * \brief  visit contacts whose name starts with 'name_prefix' (case-insensitive), in name order. O(log n + k)
+   *         With MAX_COLD_CONTACTS, the paged out matches follow (in storage order), visited as copies. These
+   *         are read from storage, so O(cold contacts) reads when the hot matches don't fill max_matches.
+   * \param  skip  number of matches to skip (for paging through results)
+   * \returns  number of matches visited
+   */
+  int searchContactsByName(const char* name_prefix, ContactVisitor* visitor, int max_matches, int skip=0);
   ContactInfo* lookupContactByPubKey(const uint8_t* pub_key, int prefix_len);
+  bool hasContact(const uint8_t* pub_key, int prefix_len);   // doesn't page in (cold contacts matched by indexed prefix only)
   bool  removeContact(ContactInfo& contact);
   bool  addContact(const ContactInfo& contact);
-  int getNumContacts() const { return num_contacts; }
-  bool getContactByIdx(uint32_t idx, ContactInfo& contact);
+  int getNumContacts() const;
+  bool getContactByIdx(uint32_t idx, ContactInfo& contact) const;   // NOTE: cold contacts are NOT paged in
   ContactsIterator startContactsIterator();
   ChannelDetails* addChannel(const char* name, const char* psk_base64);
   bool getChannel(int idx, ChannelDetails& dest);
@@ -0,0 +1,293 @@
+#include "BulkTransfer.h"
+#include <string.h>
+
+#define STATE_IDLE     0
+#define STATE_ACTIVE   1
+#define STATE_DONE     2
+#define STATE_FAILED   3
+
+bool BulkSender::begin(uint16_t xfer_id, const uint8_t* data, int len, uint32_t init_rto, uint32_t frag_airtime, unsigned long now) {
+  if (_state == STATE_ACTIVE || len <= 0 || len > BULK_MAX_LEN) return false;
+
+  _data = data;
+  _len = len;
+  _xfer_id = xfer_id;
+  _num_frags = (len + BULK_MAX_FRAG_DATA - 1) / BULK_MAX_FRAG_DATA;
+  _next_seq = 0;
+  _recover = 0;
+  memset(_tx_count, 0, sizeof(_tx_count));
+  memset(_acked, 0, sizeof(_acked));
+  memset(_fast_rexmit, 0, sizeof(_fast_rexmit));
+
+  _cwnd = 2;
+  _srtt = _rttvar = 0;   // no samples yet
+  _rto = init_rto < BULK_MIN_RTO ? BULK_MIN_RTO : (init_rto > BULK_MAX_RTO ? BULK_MAX_RTO : init_rto);
+  _min_gap = frag_airtime * BULK_PACING_FACTOR;
+  _max_sack_delay = frag_airtime * (BULK_PACING_FACTOR + 1);   // as per BaseChatMesh receiver
+
+  _next_send = _start = now;
+  _elapsed = 0;
+  _n_retransmits = 0;
+  _state = STATE_ACTIVE;
+  return true;
+}
+
+int BulkSender::countInFlight() const {
+  int n = 0;
+  for (int seq = 0; seq < _next_seq; seq++) {
+    if (!isAcked(seq)) n++;
+  }
+  return n;
+}
+
+void BulkSender::updateRTT(uint32_t sample) {   // as per RFC 6298
+  if (sample == 0) sample = 1;
+  if (_srtt == 0) {
+    _srtt = sample;
+    _rttvar = sample / 2;
+  } else {
+    uint32_t err = sample > _srtt ? sample - _srtt : _srtt - sample;
+    _rttvar = (3*_rttvar + err) / 4;
+    _srtt = (7*_srtt + sample) / 8;
+  }
+  _rto = _srtt + 4*_rttvar + _max_sack_delay;   // samples are mostly from un-delayed SACKs
+  if (_rto < BULK_MIN_RTO) _rto = BULK_MIN_RTO;
+  if (_rto > BULK_MAX_RTO) _rto = BULK_MAX_RTO;
+}
+
+void BulkSender::onLoss(int seq, bool timeout) {
+  if (timeout) {
+    _cwnd = 1;
+    _rto = _rto*2 > BULK_MAX_RTO ? BULK_MAX_RTO : _rto*2;   // back-off
+    _recover = _next_seq;
+  } else if (seq >= _recover) {    // only back-off once per window of fragments
+    _cwnd = _cwnd > 1 ? _cwnd / 2 : 1;
+    _recover = _next_seq;
+  }
+}
+
+int BulkSender::writeFragment(uint8_t* dest, int seq, unsigned long now) {
+  _tx_count[seq]++;
+  _sent_at[seq] = now;
+
+  // pace fragments over the RTT, but never closer than the path can carry them
+  uint32_t gap = _srtt / _cwnd;
+  if (gap < _min_gap) gap = _min_gap;
+  _next_send = now + gap;
+
+  int i = 0;
+  dest[i++] = BULK_KIND_DATA;
+  memcpy(&dest[i], &_xfer_id, 2); i += 2;
+  dest[i++] = seq;
+  dest[i++] = _tx_count[seq];
+  uint16_t total = _len;
+  memcpy(&dest[i], &total, 2); i += 2;
+
+  int offset = seq * BULK_MAX_FRAG_DATA;
+  int n = _len - offset;
+  if (n > BULK_MAX_FRAG_DATA) n = BULK_MAX_FRAG_DATA;
+  memcpy(&dest[i], &_data[offset], n); i += n;
+  return i;
+}
+
+int BulkSender::nextFragment(uint8_t* dest, unsigned long now) {
+  if (_state != STATE_ACTIVE || (long)(now - _next_send) < 0) return 0;   // pacing
+
+  // retransmit oldest fragment that has timed out
+  for (int seq = 0; seq < _next_seq; seq++) {
+    if (!isAcked(seq) && (long)(now - _sent_at[seq]) >= (long)_rto) {
+      if (_tx_count[seq] >= BULK_MAX_RETRIES) {
+        _state = STATE_FAILED;   // give up
+        return 0;
+      }
+      if (_fast_rexmit[seq]) {
+        _fast_rexmit[seq] = false;   // already counted as a loss
+      } else {
+        onLoss(seq, true);
+      }
+      _n_retransmits++;
+      return writeFragment(dest, seq, now);
+    }
+  }
+
+  // otherwise, a new fragment if window allows
+  if (_next_seq < _num_frags && countInFlight() < _cwnd) {
+    return writeFragment(dest, _next_seq++, now);
+  }
+  return 0;
+}
+
+void BulkSender::onSack(const uint8_t* data, int len, unsigned long now) {
+  if (_state != STATE_ACTIVE || len < BULK_SACK_SIZE || data[0] != BULK_KIND_SACK) return;
+
+  uint16_t xfer_id;
+  memcpy(&xfer_id, &data[1], 2);
+  if (xfer_id != _xfer_id) return;   // stale
+
+  uint8_t cum_seq = data[3];
+  uint32_t bitmap;
+  memcpy(&bitmap, &data[4], 4);
+  uint8_t echo_seq = data[8];
+  uint8_t echo_tx = data[9];
+
+  bool progress = false;
+  for (int seq = 0; seq < cum_seq && seq < _num_frags; seq++) {
+    if (!isAcked(seq)) { setAcked(seq); progress = true; }
+  }
+  for (int b = 0; b < BULK_SACK_BITS; b++) {
+    int seq = cum_seq + 1 + b;
+    if (seq >= _num_frags) break;
+    if ((bitmap & (1UL << b)) && !isAcked(seq)) { setAcked(seq); progress = true; }
+  }
+
+  // only sample RTT if this SACK was for the LATEST transmission of echo_seq
+  if (echo_seq < _num_frags && echo_tx > 0 && _tx_count[echo_seq] == echo_tx) {
+    updateRTT(now - _sent_at[echo_seq]);
+
+    // fragments sent BEFORE the one which triggered this SACK, but still missing, must have been lost
+    for (int seq = cum_seq; seq < _next_seq; seq++) {
+      if (!isAcked(seq) && !_fast_rexmit[seq] && (long)(_sent_at[echo_seq] - _sent_at[seq]) > 0) {
+        onLoss(seq, false);
+        _fast_rexmit[seq] = true;
+        _sent_at[seq] = now - _rto;   // retransmit as soon as pacing allows
+      }
+    }
+  }
+
+  if (progress && _cwnd < BULK_MAX_WINDOW) _cwnd++;
+
+  for (int seq = 0; seq < _num_frags; seq++) {
+    if (!isAcked(seq)) return;   // still more to go
+  }
+  _state = STATE_DONE;
+  _elapsed = now - _start;
+}
+
+void BulkSender::onCancel(const uint8_t* data, int len) {
+  if (_state != STATE_ACTIVE || len < 3 || data[0] != BULK_KIND_CANCEL) return;
+
+  uint16_t xfer_id;
+  memcpy(&xfer_id, &data[1], 2);
+  if (xfer_id == _xfer_id) _state = STATE_FAILED;
+}
+
+int BulkSender::writeCancel(uint8_t* dest) const {
+  dest[0] = BULK_KIND_CANCEL;
+  memcpy(&dest[1], &_xfer_id, 2);
+  return 3;
+}
+
+void BulkReceiver::begin(uint16_t xfer_id, uint8_t* buf, int buf_sz, uint32_t sack_delay, unsigned long now) {
+  _xfer_id = xfer_id;
+  _buf = buf;
+  _buf_sz = buf_sz;
+  _len = 0;
+  _num_frags = 0;
+  _cum_seq = 0;
+  memset(_recvd, 0, sizeof(_recvd));
+  _unacked = 0;
+  _sack_delay = sack_delay;
+  _sack_pending = false;
+  _last_recv = now;
+  _state = STATE_ACTIVE;
+}
+
+bool BulkReceiver::isNewTransfer(const uint8_t* data, int len) const {
+  if (len < BULK_DATA_HDR_SIZE || data[0] != BULK_KIND_DATA) return false;
+
+  uint16_t xfer_id;
+  memcpy(&xfer_id, &data[1], 2);
+  return _state == STATE_IDLE || xfer_id != _xfer_id;
+}
+
+bool BulkReceiver::isAcceptable(const uint8_t* data, int len, int buf_sz) {
+  if (len < BULK_DATA_HDR_SIZE || data[0] != BULK_KIND_DATA) return false;
+
+  uint16_t total;
+  memcpy(&total, &data[5], 2);
+  int num_frags = (total + BULK_MAX_FRAG_DATA - 1) / BULK_MAX_FRAG_DATA;
+  return total > 0 && total <= buf_sz && num_frags <= BULK_MAX_FRAGS;
+}
+
+bool BulkReceiver::isCancel(const uint8_t* data, int len) const {
+  if (_state == STATE_IDLE || len < 3 || data[0] != BULK_KIND_CANCEL) return false;
+
+  uint16_t xfer_id;
+  memcpy(&xfer_id, &data[1], 2);
+  return xfer_id == _xfer_id;
+}
+
+int BulkReceiver::onFragment(const uint8_t* data, int len, unsigned long now) {
+  if (_state == STATE_IDLE || len < BULK_DATA_HDR_SIZE || data[0] != BULK_KIND_DATA) return -1;
+
+  uint16_t xfer_id;
+  memcpy(&xfer_id, &data[1], 2);
+  if (xfer_id != _xfer_id) return -1;
+
+  uint8_t seq = data[3];
+  uint8_t tx_count = data[4];
+  uint16_t total;
+  memcpy(&total, &data[5], 2);
+  int num_frags = (total + BULK_MAX_FRAG_DATA - 1) / BULK_MAX_FRAG_DATA;
+  if (total == 0 || total > _buf_sz || num_frags > BULK_MAX_FRAGS || seq >= num_frags) return -1;   // invalid, or too big for us
+  if (_num_frags && num_frags != _num_frags) return -1;
+
+  _num_frags = num_frags;
+  _len = total;
+  _echo_seq = seq;
+  _echo_tx = tx_count;
+  _last_recv = now;
+
+  if (_state == STATE_DONE || isRecvd(seq)) {   // a duplicate, so our last SACK was probably lost
+    _sack_due = now;
+    _sack_pending = true;
+    return 0;
+  }
+
+  int offset = seq * BULK_MAX_FRAG_DATA;
+  int n = total - offset;
+  if (n > BULK_MAX_FRAG_DATA) n = BULK_MAX_FRAG_DATA;
+  if (len - BULK_DATA_HDR_SIZE < n) return -1;   // truncated
+
+  memcpy(&_buf[offset], &data[BULK_DATA_HDR_SIZE], n);
+  _recvd[seq >> 3] |= (1 << (seq & 7));
+
+  bool gap = seq > _cum_seq;   // an earlier fragment is missing
+  while (_cum_seq < _num_frags && isRecvd(_cum_seq)) _cum_seq++;
+  _unacked++;
+
+  if (_cum_seq >= _num_frags) {
+    _state = STATE_DONE;
+    _sack_due = now;   // final SACK, straight away
+    _sack_pending = true;
+    return 1;
+  }
+  if (gap || _unacked >= 2) {
+    _sack_due = now;
+    _sack_pending = true;
+  } else if (!_sack_pending) {
+    _sack_due = now + _sack_delay;   // wait a bit, in case more fragments are coming
+    _sack_pending = true;
+  }
+  return 0;
+}
+
+int BulkReceiver::writeSack(uint8_t* dest) {
+  dest[0] = BULK_KIND_SACK;
+  memcpy(&dest[1], &_xfer_id, 2);
+  dest[3] = _cum_seq;
+
+  uint32_t bitmap = 0;
+  for (int b = 0; b < BULK_SACK_BITS; b++) {
+    int seq = _cum_seq + 1 + b;
+    if (seq >= _num_frags) break;
+    if (isRecvd(seq)) bitmap |= (1UL << b);
+  }
+  memcpy(&dest[4], &bitmap, 4);
+  dest[8] = _echo_seq;
+  dest[9] = _echo_tx;
+
+  _unacked = 0;
+  _sack_pending = false;
+  return BULK_SACK_SIZE;
+}
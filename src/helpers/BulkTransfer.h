@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bulk transfer of blobs larger than a single packet, carried in PAYLOAD_TYPE_BULK datagrams over a known direct route.
+ *
+ *   DATA:    [kind][xfer_id:2][seq][tx_count][total_len:2][data...]
+ *   SACK:    [kind][xfer_id:2][cum_seq][bitmap:4][echo_seq][echo_tx]
+ *   CANCEL:  [kind][xfer_id:2]     (sender abandoning, or receiver refusing, a transfer)
+ *
+ * 'cum_seq' is the next fragment the receiver is missing (all before it are received), bit N of 'bitmap' is for
+ * fragment (cum_seq + 1 + N). 'echo_seq'/'echo_tx' identify the fragment transmission that triggered the SACK, for RTT sampling.
+ * 'tx_count' also makes each retransmission a unique packet, so repeaters don't drop it as already seen.
+ */
+#define BULK_KIND_DATA      0x00
+#define BULK_KIND_SACK      0x01
+#define BULK_KIND_CANCEL    0x02
+
+#define BULK_DATA_HDR_SIZE     7
+#define BULK_SACK_SIZE        10
+#define BULK_MAX_FRAG_DATA   160   // with header, pads to 176 cipher bytes (fits both PAYLOAD_VER_1 and _2 datagrams)
+#define BULK_SACK_BITS        32
+
+#ifndef BULK_MAX_FRAGS
+  #define BULK_MAX_FRAGS      64   // ie. max blob is 10KB
+#endif
+#define BULK_MAX_LEN   (BULK_MAX_FRAGS*BULK_MAX_FRAG_DATA)
+
+static_assert(BULK_MAX_FRAGS > 0 && BULK_MAX_FRAGS <= 255, "BULK_MAX_FRAGS must fit the 1-byte seq/count fields");
+
+#ifndef BULK_MAX_WINDOW
+  #define BULK_MAX_WINDOW      8
+#endif
+
+#ifndef BULK_MAX_RETRIES
+  #define BULK_MAX_RETRIES     5   // per fragment
+#endif
+
+#ifndef BULK_PACING_FACTOR
+  #define BULK_PACING_FACTOR   3   // min gap between fragments, in fragment airtimes (so hops 1 and 2 can forward, before we transmit again)
+#endif
+
+#define BULK_MIN_RTO        1000
+#define BULK_MAX_RTO       60000
+
+class BulkSender {
+  const uint8_t* _data;
+  int _len;
+  uint16_t _xfer_id;
+  uint8_t _num_frags;
+  uint8_t _next_seq;    // next fragment never sent
+  uint8_t _recover;     // losses of fragments before this are from the same window
+  uint8_t _state;
+  uint8_t _cwnd;
+  uint8_t _tx_count[BULK_MAX_FRAGS];   // 0 = not sent yet
+  unsigned long _sent_at[BULK_MAX_FRAGS];
+  uint8_t _acked[(BULK_MAX_FRAGS + 7) / 8];
+  bool _fast_rexmit[BULK_MAX_FRAGS];
+  uint32_t _srtt, _rttvar, _rto;
+  uint32_t _min_gap, _max_sack_delay;
+  unsigned long _next_send, _start;
+  uint32_t _elapsed;
+  uint16_t _n_retransmits;
+
+  bool isAcked(int seq) const { return (_acked[seq >> 3] & (1 << (seq & 7))) != 0; }
+  void setAcked(int seq) { _acked[seq >> 3] |= (1 << (seq & 7)); }
+  int  countInFlight() const;
+  int  writeFragment(uint8_t* dest, int seq, unsigned long now);
+  void updateRTT(uint32_t sample);
+  void onLoss(int seq, bool timeout);
+
+public:
+  BulkSender() { _state = 0; _n_retransmits = 0; _elapsed = 0; }
+
+  /**
+   * \brief  start a new transfer. NOTE: 'data' must remain valid until transfer is no longer active.
+   * \param  init_rto  initial retransmit timeout (eg. calculated from path length), until RTT samples are available
+   * \param  frag_airtime  estimated airtime of one full fragment packet
+   */
+  bool begin(uint16_t xfer_id, const uint8_t* data, int len, uint32_t init_rto, uint32_t frag_airtime, unsigned long now);
+
+  /**
+   * \returns  length of next fragment written to dest (must be BULK_DATA_HDR_SIZE + BULK_MAX_FRAG_DATA), or 0 if nothing is due yet
+   */
+  int nextFragment(uint8_t* dest, unsigned long now);
+
+  void onSack(const uint8_t* data, int len, unsigned long now);
+  void onCancel(const uint8_t* data, int len);   // receiver refused (or abandoned) the transfer
+  int  writeCancel(uint8_t* dest) const;
+  void cancel() { if (_state == 1) _state = 3; }
+
+  bool isActive() const { return _state == 1; }
+  bool isDone() const { return _state == 2; }
+  bool hasFailed() const { return _state == 3; }
+  uint16_t getXferId() const { return _xfer_id; }
+  uint8_t getWindow() const { return _cwnd; }
+  uint32_t getSmoothedRTT() const { return _srtt; }
+  uint16_t getNumRetransmits() const { return _n_retransmits; }
+  uint32_t getElapsedMillis() const { return _elapsed; }
+  uint32_t getGoodput() const { return _elapsed > 0 ? (uint32_t)(((uint64_t)_len * 1000) / _elapsed) : 0; }   // bytes/sec, of last completed transfer
+};
+
+class BulkReceiver {
+  uint8_t* _buf;
+  int _buf_sz;
+  int _len;
+  uint16_t _xfer_id;
+  uint8_t _num_frags;
+  uint8_t _cum_seq;
+  uint8_t _recvd[(BULK_MAX_FRAGS + 7) / 8];
+  uint8_t _echo_seq, _echo_tx;
+  uint8_t _unacked;
+  uint8_t _state;
+  bool _sack_pending;
+  uint32_t _sack_delay;
+  unsigned long _sack_due, _last_recv;
+
+  bool isRecvd(int seq) const { return (_recvd[seq >> 3] & (1 << (seq & 7))) != 0; }
+
+public:
+  BulkReceiver() { _state = 0; _sack_pending = false; }
+
+  /**
+   * \brief  accept a new transfer, into the given buffer.
+   * \param  sack_delay  max millis to delay a SACK, waiting for more fragments
+   */
+  void begin(uint16_t xfer_id, uint8_t* buf, int buf_sz, uint32_t sack_delay, unsigned long now);
+
+  /**
+   * \returns  true if 'data' is a DATA fragment that is NOT for the current transfer (ie. caller should begin() a new one)
+   */
+  bool isNewTransfer(const uint8_t* data, int len) const;
+
+  /**
+   * \returns  true if DATA fragment is for a transfer of a size we can take, into a buffer of 'buf_sz'
+   */
+  static bool isAcceptable(const uint8_t* data, int len, int buf_sz);
+
+  /**
+   * \returns  -1 if rejected, 0 if accepted, 1 if the transfer is now complete
+   */
+  int onFragment(const uint8_t* data, int len, unsigned long now);
+  bool isCancel(const uint8_t* data, int len) const;
+
+  bool isSackDue(unsigned long now) const { return _sack_pending && (long)(now - _sack_due) >= 0; }
+  bool isStale(unsigned long now, uint32_t timeout) const { return (long)(now - _last_recv) > (long)timeout; }
+  int  writeSack(uint8_t* dest);   // dest must be BULK_SACK_SIZE
+
+  void reset() { _state = 0; _sack_pending = false; }
+  bool isActive() const { return _state == 1; }
+  bool isComplete() const { return _state == 2; }
+  uint16_t getXferId() const { return _xfer_id; }
+  const uint8_t* getData() const { return _buf; }
+  int getLength() const { return _len; }
+};
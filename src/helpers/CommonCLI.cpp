@@ -58,6 +58,8 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     file.read((uint8_t *) &_prefs->flood_max, sizeof(_prefs->flood_max));   // 124
     file.read((uint8_t *) &_prefs->flood_advert_interval, sizeof(_prefs->flood_advert_interval));  // 125
     file.read((uint8_t *) &_prefs->interference_threshold, sizeof(_prefs->interference_threshold));  // 126
+    file.read((uint8_t *) &_prefs->passive_ack_retries, sizeof(_prefs->passive_ack_retries));  // 127
+    file.read((uint8_t *) &_prefs->tx_weights[0], sizeof(_prefs->tx_weights));  // 128
 
     // sanitise bad pref values
     _prefs->rx_delay_base = constrain(_prefs->rx_delay_base, 0, 20.0f);
@@ -70,6 +72,11 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     _prefs->cr = constrain(_prefs->cr, 5, 8);
     _prefs->tx_power_dbm = constrain(_prefs->tx_power_dbm, 1, 30);
     _prefs->multi_acks = constrain(_prefs->multi_acks, 0, 1);
+    _prefs->passive_ack_retries = constrain(_prefs->passive_ack_retries, 0, 3);
+    for (int c = 0; c < TX_NUM_CLASSES; c++) {
+      _prefs->tx_weights[c] = constrain(_prefs->tx_weights[c], 0, 16);
+      if (_prefs->tx_weights[c] == 0) _prefs->tx_weights[0] = 0;   // any zero means off
+    }
 
     file.close();
   }
@@ -114,6 +121,8 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
     file.write((uint8_t *) &_prefs->flood_max, sizeof(_prefs->flood_max));   // 124
     file.write((uint8_t *) &_prefs->flood_advert_interval, sizeof(_prefs->flood_advert_interval));  // 125
     file.write((uint8_t *) &_prefs->interference_threshold, sizeof(_prefs->interference_threshold));  // 126
+    file.write((uint8_t *) &_prefs->passive_ack_retries, sizeof(_prefs->passive_ack_retries));  // 127
+    file.write((uint8_t *) &_prefs->tx_weights[0], sizeof(_prefs->tx_weights));  // 128
 
     file.close();
   }
@@ -121,6 +130,8 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
 
 #define MIN_LOCAL_ADVERT_INTERVAL   60
 
+static const char* tx_class_names[TX_NUM_CLASSES] = { "own", "dir", "fld", "adv" };
+
 void CommonCLI::savePrefs() {
   if (_prefs->advert_interval * 2 < MIN_LOCAL_ADVERT_INTERVAL) {
     _prefs->advert_interval = 0;  // turn it off, now that device has been manually configured
@@ -198,6 +209,30 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         sprintf(reply, "> %d", ((uint32_t) _prefs->agc_reset_interval) * 4);
       } else if (memcmp(config, "multi.acks", 10) == 0) {
         sprintf(reply, "> %d", (uint32_t) _prefs->multi_acks);
+      } else if (memcmp(config, "passive.ack", 11) == 0) {
+        sprintf(reply, "> %d", (uint32_t) _prefs->passive_ack_retries);
+      } else if (memcmp(config, "tx.weights", 10) == 0) {
+        if (_prefs->tx_weights[0] == 0) {
+          strcpy(reply, "> off");
+        } else {
+          sprintf(reply, "> %d,%d,%d,%d", (uint32_t)_prefs->tx_weights[0], (uint32_t)_prefs->tx_weights[1], (uint32_t)_prefs->tx_weights[2], (uint32_t)_prefs->tx_weights[3]);
+        }
+      } else if (memcmp(config, "tx.delays", 9) == 0) {
+        // per traffic class: num packets sent, then percent in each queueing delay bucket (<32ms, <64 ... <2048, 2048+)
+        char *dp = reply;
+        for (int c = 0; c < TX_NUM_CLASSES; c++) {
+          const uint32_t* hist = _callbacks->getTxDelayHistogram(c);
+          uint32_t total = 0;
+          for (int b = 0; b < TX_DELAY_BUCKETS; b++) total += hist[b];
+
+          if (c > 0) *dp++ = '\n';
+          sprintf(dp, "%s %lu:", tx_class_names[c], (unsigned long)total);
+          while (*dp) dp++;
+          for (int b = 0; b < TX_DELAY_BUCKETS; b++) {
+            sprintf(dp, b > 0 ? ",%lu" : "%lu", (unsigned long)(total ? (hist[b] * 100 + total/2) / total : 0));
+            while (*dp) dp++;
+          }
+        }
       } else if (memcmp(config, "allow.read.only", 15) == 0) {
         sprintf(reply, "> %s", _prefs->allow_read_only ? "on" : "off");
       } else if (memcmp(config, "flood.advert.interval", 21) == 0) {
@@ -257,6 +292,40 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, const char* command, ch
         _prefs->multi_acks = atoi(&config[11]);
         savePrefs();
         strcpy(reply, "OK");
+      } else if (memcmp(config, "passive.ack ", 12) == 0) {
+        int n = atoi(&config[12]);
+        if (n >= 0 && n <= 3) {
+          _prefs->passive_ack_retries = n;
+          savePrefs();
+          strcpy(reply, "OK");
+        } else {
+          strcpy(reply, "Error, range is 0-3");
+        }
+      } else if (memcmp(config, "tx.weights ", 11) == 0) {
+        if (memcmp(&config[11], "off", 3) == 0) {
+          memset(_prefs->tx_weights, 0, sizeof(_prefs->tx_weights));
+          savePrefs();
+          _callbacks->updateTxScheduler();
+          strcpy(reply, "OK - strict priority");
+        } else {
+          strcpy(tmp, &config[11]);
+          const char *parts[TX_NUM_CLASSES];
+          int num = mesh::Utils::parseTextParts(tmp, parts, TX_NUM_CLASSES);
+          int w[TX_NUM_CLASSES];
+          bool valid = num == TX_NUM_CLASSES;
+          for (int c = 0; valid && c < TX_NUM_CLASSES; c++) {
+            w[c] = atoi(parts[c]);
+            if (w[c] < 1 || w[c] > 16) valid = false;
+          }
+          if (valid) {
+            for (int c = 0; c < TX_NUM_CLASSES; c++) _prefs->tx_weights[c] = w[c];
+            savePrefs();
+            _callbacks->updateTxScheduler();
+            strcpy(reply, "OK");
+          } else {
+            strcpy(reply, "Error, expected: own,direct,flood,advert (each 1-16), or 'off'");
+          }
+        }
       } else if (memcmp(config, "allow.read.only ", 16) == 0) {
         _prefs->allow_read_only = memcmp(&config[16], "on", 2) == 0;
         savePrefs();
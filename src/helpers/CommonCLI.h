@@ -26,6 +26,8 @@ struct NodePrefs {  // persisted to file
     uint8_t flood_max;
     uint8_t interference_threshold;
     uint8_t agc_reset_interval;   // secs / 4
+    uint8_t passive_ack_retries;
+    uint8_t tx_weights[TX_NUM_CLASSES];   // for fair scheduling between TX_CLASS_*, all zero for strict priority
 };
 
 class CommonCLICallbacks {
@@ -46,6 +48,8 @@ public:
   virtual const uint8_t* getSelfIdPubKey() = 0;
   virtual void clearStats() = 0;
   virtual void applyTempRadioParams(float freq, float bw, uint8_t sf, uint8_t cr, int timeout_mins) = 0;
+  virtual void updateTxScheduler() = 0;
+  virtual const uint32_t* getTxDelayHistogram(int tx_class) = 0;
 };
 
 class CommonCLI {
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \brief  Slot allocator + hash index for a fixed table of N contacts. Slots never move once allocated (so a slot
+ *         number, or pointer into the table, stays valid until that contact is removed). Slots are chained into
+ *         256 buckets by first byte of pub_key (ie. the path hash), so lookups only visit contacts with matching hash.
+ *         All operations are O(1), except walking a bucket.
+ */
+template <int N>
+class ContactIndex {
+  static_assert(N > 0 && N < 0xFFFF, "ContactIndex size out of range");
+
+  static const uint16_t NONE = 0xFFFF;
+
+  uint16_t _bucket[256];     // first slot in each bucket
+  uint16_t _next[N], _prev[N];   // bucket chains
+  uint16_t _order[N];   // [0.._num) are slots in use (in 'index' order), the rest are free
+  uint16_t _pos[N];     // where each slot is in _order
+  int _num;
+
+public:
+  ContactIndex() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < 256; i++) _bucket[i] = NONE;
+    for (int i = 0; i < N; i++) { _order[i] = _pos[i] = i; }
+    _num = 0;
+  }
+
+  int count() const { return _num; }
+  bool isFull() const { return _num >= N; }
+  bool isUsed(int slot) const { return slot >= 0 && slot < N && _pos[slot] < _num; }
+  int slotAt(int idx) const { return _order[idx]; }   // idx must be < count()
+
+  /**
+   * \returns  new slot, linked into bucket for 'hash', or -1 if table is full
+   */
+  int alloc(uint8_t hash) {
+    if (_num >= N) return -1;
+    uint16_t slot = _order[_num++];
+    _prev[slot] = NONE;
+    _next[slot] = _bucket[hash];
+    if (_next[slot] != NONE) _prev[_next[slot]] = slot;
+    _bucket[hash] = slot;
+    return slot;
+  }
+
+  /**
+   * \brief  unlink 'slot' from its bucket, and return it to free list. NOTE: the last contact (by index) takes its place in index order.
+   */
+  void free(int slot, uint8_t hash) {
+    if (!isUsed(slot)) return;
+
+    if (_prev[slot] != NONE) _next[_prev[slot]] = _next[slot]; else _bucket[hash] = _next[slot];
+    if (_next[slot] != NONE) _prev[_next[slot]] = _prev[slot];
+
+    uint16_t p = _pos[slot];
+    uint16_t last = _order[--_num];
+    _order[p] = last; _pos[last] = p;
+    _order[_num] = slot; _pos[slot] = _num;
+  }
+
+  // bucket walk:  for (int s = first(hash); s >= 0; s = next(s)) { .. }
+  int first(uint8_t hash) const { return _bucket[hash] == NONE ? -1 : _bucket[hash]; }
+  int next(int slot) const { return _next[slot] == NONE ? -1 : _next[slot]; }
+};
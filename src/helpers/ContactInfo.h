@@ -10,6 +10,9 @@ struct ContactInfo {
   uint8_t flags;
   int8_t out_path_len;
   uint8_t out_path[MAX_PATH_SIZE];
+  uint8_t out_path_ver;   // PAYLOAD_VER_* that out_path was learned with (ie. size of hashes in out_path)
+  uint8_t payload_ver;    // highest PAYLOAD_VER_* they can receive (from their adverts)
+  uint16_t adv_feat1;     // ADV_FEAT1_* bits from their last advert (0 until heard)
   uint32_t last_advert_timestamp;   // by THEIR clock
   uint8_t shared_secret[PUB_KEY_SIZE];
   uint32_t lastmod;  // by OUR clock
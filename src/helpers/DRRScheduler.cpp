@@ -0,0 +1,41 @@
+#include "DRRScheduler.h"
+#include <string.h>
+
+DRRScheduler::DRRScheduler() {
+  memset(_weights, 1, sizeof(_weights));
+  memset(_deficit, 0, sizeof(_deficit));
+  _curr = 0;
+}
+
+void DRRScheduler::setWeights(const uint8_t weights[]) {
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    _weights[c] = weights[c] > 0 ? weights[c] : 1;
+  }
+  memset(_deficit, 0, sizeof(_deficit));
+}
+
+int DRRScheduler::selectClass(const int head_len[], bool peek) {
+  int deficit[TX_NUM_CLASSES];
+  memcpy(deficit, _deficit, sizeof(deficit));
+  int c = _curr;
+
+  // stay with current class while it has credit, otherwise top it up and move on to next class
+  for (;;) {   // NOTE: caller guarantees at least one class has a packet, so this will terminate
+    if (head_len[c] > 0) {
+      if (deficit[c] >= head_len[c]) {
+        deficit[c] -= head_len[c];
+        break;
+      }
+      deficit[c] += _weights[c] * DRR_QUANTUM_BYTES;
+    } else {
+      deficit[c] = 0;   // idle classes don't save up credit
+    }
+    c = (c + 1) % TX_NUM_CLASSES;
+  }
+
+  if (!peek) {
+    memcpy(_deficit, deficit, sizeof(_deficit));
+    _curr = c;
+  }
+  return c;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Dispatcher.h>
+
+#ifndef DRR_QUANTUM_BYTES
+  #define DRR_QUANTUM_BYTES   64   // credit per round, per unit of class weight
+#endif
+
+/**
+ * \brief  Deficit round-robin between the TX_CLASS_* traffic classes. Each class gets a share of the airtime in
+ *         proportion to its weight (when it has packets waiting), so a flood storm can't starve direct traffic
+ *         or our own packets, and vice versa.
+ */
+class DRRScheduler : public mesh::OutboundScheduler {
+  uint8_t _weights[TX_NUM_CLASSES];
+  int _deficit[TX_NUM_CLASSES];
+  uint8_t _curr;
+
+public:
+  DRRScheduler();
+
+  void setWeights(const uint8_t weights[]);   // TX_NUM_CLASSES entries, zero is treated as 1
+  const uint8_t* getWeights() const { return _weights; }
+
+  int selectClass(const int head_len[], bool peek) override;
+};
@@ -8,6 +8,17 @@
 #include <rom/rtc.h>
 #include <sys/time.h>
 #include <Wire.h>
+#if defined(ESP32_LIGHT_SLEEP) && !defined(P_LORA_IRQ) && defined(P_LORA_DIO_1)
+  #define P_LORA_IRQ   P_LORA_DIO_1    // SX126x/LR11x0 IRQ pin (SX127x variants set this to P_LORA_DIO_0)
+#endif
+#if defined(ESP32_LIGHT_SLEEP) && defined(P_LORA_IRQ)
+  #include <esp_sleep.h>
+  #include <driver/gpio.h>
+#endif
+
+#ifndef ESP32_MIN_SLEEP_MILLIS
+  #define ESP32_MIN_SLEEP_MILLIS   10    // not worth the light sleep entry/exit overhead for less
+#endif
 
 class ESP32Board : public mesh::MainBoard {
 protected:
@@ -87,6 +98,21 @@ public:
   }
 
   bool startOTAUpdate(const char* id, char reply[]) override;
+
+#if defined(ESP32_LIGHT_SLEEP) && defined(P_LORA_IRQ)
+  // NOTE: Serial RX does NOT wake from light sleep, so best only for headless/battery nodes
+  void sleep(uint32_t millis) override {
+    if (millis < ESP32_MIN_SLEEP_MILLIS) return;
+
+    esp_sleep_enable_timer_wakeup((uint64_t)millis * 1000);
+    gpio_wakeup_enable((gpio_num_t)P_LORA_IRQ, GPIO_INTR_HIGH_LEVEL);   // wake up on: recv/sent LoRa packet
+    esp_sleep_enable_gpio_wakeup();
+    esp_light_sleep_start();   // returns on wake-up, millis() is kept up to date
+
+    gpio_wakeup_disable((gpio_num_t)P_LORA_IRQ);
+    gpio_set_intr_type((gpio_num_t)P_LORA_IRQ, GPIO_INTR_POSEDGE);   // restore RadioLib's RISING interrupt
+  }
+#endif
 };
 
 class ESP32RTCClock : public mesh::RTCClock {
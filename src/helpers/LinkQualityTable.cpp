@@ -0,0 +1,58 @@
+#include "LinkQualityTable.h"
+
+#define LINK_EWMA_ALPHA   0.125f
+
+static bool isLinkMatch(const mesh::LinkQuality* l, const uint8_t* hash, uint8_t hash_size) {
+  // NOTE: entries may have been created from a shorter hash (ie. PAYLOAD_VER_1), so just compare common prefix
+  return memcmp(l->hash, hash, hash_size < l->hash_size ? hash_size : l->hash_size) == 0;
+}
+
+mesh::LinkQuality* LinkQualityTable::findOrAdd(const uint8_t* hash, uint8_t hash_size) {
+  if (hash_size > MAX_PATH_HASH_SIZE) hash_size = MAX_PATH_HASH_SIZE;
+
+  mesh::LinkQuality* l = NULL;
+  for (int i = 0; i < _num; i++) {
+    if (isLinkMatch(&_links[i], hash, hash_size)) { l = &_links[i]; break; }
+  }
+  if (l == NULL) {
+    if (_num < MAX_LINK_QUALITY_ENTRIES) {
+      l = &_links[_num++];
+    } else {   // replace least recently updated
+      l = &_links[0];
+      for (int i = 1; i < _num; i++) {
+        if (_links[i].last_update < l->last_update) l = &_links[i];
+      }
+    }
+    memset(l, 0, sizeof(*l));
+    l->delivery = 1.0f;   // optimistic, until proven otherwise
+  }
+  if (hash_size > l->hash_size) {   // upgrade to longer hash
+    memcpy(l->hash, hash, hash_size);
+    l->hash_size = hash_size;
+  }
+  l->last_update = ++_counter;
+  return l;
+}
+
+void LinkQualityTable::onRecv(const uint8_t* hash, uint8_t hash_size, float snr) {
+  auto l = findOrAdd(hash, hash_size);
+  if (l->n_heard == 0) {
+    l->snr = snr;
+  } else {
+    l->snr += LINK_EWMA_ALPHA * (snr - l->snr);
+  }
+  if (l->n_heard < 0xFFFF) l->n_heard++;
+}
+
+void LinkQualityTable::onDelivery(const uint8_t* hash, uint8_t hash_size, bool delivered) {
+  auto l = findOrAdd(hash, hash_size);
+  l->delivery += LINK_EWMA_ALPHA * ((delivered ? 1.0f : 0.0f) - l->delivery);
+  if (l->n_sent < 0xFFFF) l->n_sent++;
+}
+
+const mesh::LinkQuality* LinkQualityTable::find(const uint8_t* hash, uint8_t hash_size) const {
+  for (int i = 0; i < _num; i++) {
+    if (isLinkMatch(&_links[i], hash, hash_size)) return &_links[i];
+  }
+  return NULL;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifndef MAX_LINK_QUALITY_ENTRIES
+  #define MAX_LINK_QUALITY_ENTRIES   32
+#endif
+
+/**
+ * \brief  Estimates the quality of links with neighbours (by path hash), from the SNR of packets heard from them,
+ *       and the outcomes of packets sent via them (ie. EWMA delivery ratio, and the ETX derived from it).
+ *       Least recently updated entry is replaced when full.
+ */
+class LinkQualityTable {
+  mesh::LinkQuality _links[MAX_LINK_QUALITY_ENTRIES];
+  int _num;
+  uint32_t _counter;
+
+  mesh::LinkQuality* findOrAdd(const uint8_t* hash, uint8_t hash_size);
+
+public:
+  LinkQualityTable() { _num = 0; _counter = 0; }
+
+  void onRecv(const uint8_t* hash, uint8_t hash_size, float snr);
+  void onDelivery(const uint8_t* hash, uint8_t hash_size, bool delivered);
+
+  /**
+   * \returns  the entry for the given neighbour hash, or NULL if not known
+   */
+  const mesh::LinkQuality* find(const uint8_t* hash, uint8_t hash_size) const;
+
+  int getCount() const { return _num; }
+  const mesh::LinkQuality* getByIdx(int i) const { return i >= 0 && i < _num ? &_links[i] : NULL; }
+  void clear() { _num = 0; }
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef LORA_PREAMBLE_LEN
+  #define LORA_PREAMBLE_LEN   16    // symbols, as per Custom*::std_init()
+#endif
+
+/**
+ * \brief  compile-time LoRa time-on-air calculator (explicit header, CRC on, LDRO when symbol time >= 16ms),
+ *         as per Semtech SX126x datasheet 6.1.4 / RadioLib getTimeOnAir(). For host builds and tools, and
+ *         static_assert()s on SF/BW/CR combinations, eg.
+ *
+ *    static_assert(LoRaAirtime::millis(255, 10, 250.0f, 5) < 1200, "max packet too slow");
+ *
+ *  'cr' is the coding-rate denominator (5..8), as passed to radio_set_params(). 'sf' is 5..12.
+ */
+class LoRaAirtime {
+  static constexpr bool isLowDataRate(uint8_t sf, float bw_khz) { return (float)(1UL << sf) / bw_khz >= 16.0f; }
+
+  static constexpr int32_t payloadBits(int len, uint8_t sf) {
+    return 8*len + 16 - 4*sf + (sf < 7 ? 0 : 8) + 20;
+  }
+  static constexpr uint32_t payloadSymbols(int len, uint8_t sf, float bw_khz, uint8_t cr) {
+    return payloadBits(len, sf) <= 0 ? 0 :
+        ((uint32_t)payloadBits(len, sf) + 4*(sf - (isLowDataRate(sf, bw_khz) ? 2 : 0)) - 1)
+          / (4*(sf - (isLowDataRate(sf, bw_khz) ? 2 : 0))) * cr;
+  }
+
+public:
+  static constexpr uint32_t symbolMicros(uint8_t sf, float bw_khz) {
+    return (uint32_t)((float)(1UL << sf) * 1000.0f / bw_khz);
+  }
+
+  /**
+   * \returns  number of symbols x 4 (so the preamble's fractional symbols are exact)
+   */
+  static constexpr uint32_t symbolsX4(int len, uint8_t sf, float bw_khz, uint8_t cr, uint16_t preamble_len=LORA_PREAMBLE_LEN) {
+    return (preamble_len + 8)*4 + (sf < 7 ? 25 : 17) + payloadSymbols(len, sf, bw_khz, cr)*4;
+  }
+
+  static constexpr uint32_t micros(int len, uint8_t sf, float bw_khz, uint8_t cr, uint16_t preamble_len=LORA_PREAMBLE_LEN) {
+    return (uint32_t)(((uint64_t)symbolMicros(sf, bw_khz) * symbolsX4(len, sf, bw_khz, cr, preamble_len)) / 4);
+  }
+
+  static constexpr uint32_t millis(int len, uint8_t sf, float bw_khz, uint8_t cr, uint16_t preamble_len=LORA_PREAMBLE_LEN) {
+    return micros(len, sf, bw_khz, cr, preamble_len) / 1000;
+  }
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * \brief  Intrusive list of N slots, kept sorted by a timestamp key (newest first), so 'most recent' scans need no
+ *         sorting. Inserting is O(1) when the key is newer than all others (or older), as is typical of new adverts,
+ *         otherwise walks from the newest end. Slots must only be inserted once (ie. remove() before re-inserting).
+ */
+template <int N>
+class RecencyList {
+  static_assert(N > 0 && N < 0xFFFF, "RecencyList size out of range");
+
+  static const uint16_t NONE = 0xFFFF;
+
+  uint16_t _head, _tail;   // newest, oldest
+  uint16_t _next[N], _prev[N];
+  uint32_t _key[N];
+
+  void linkBefore(int slot, uint16_t before) {   // before == NONE, means append at tail
+    _next[slot] = before;
+    _prev[slot] = before == NONE ? _tail : _prev[before];
+    if (_prev[slot] != NONE) _next[_prev[slot]] = slot; else _head = slot;
+    if (before != NONE) _prev[before] = slot; else _tail = slot;
+  }
+
+public:
+  RecencyList() { clear(); }
+
+  void clear() { _head = _tail = NONE; }
+
+  void insert(int slot, uint32_t key) {
+    _key[slot] = key;
+    if (_head == NONE || key >= _key[_head]) {
+      linkBefore(slot, _head);
+    } else if (key <= _key[_tail]) {
+      linkBefore(slot, NONE);
+    } else {
+      uint16_t s = _head;
+      while (s != NONE && _key[s] > key) s = _next[s];
+      linkBefore(slot, s);
+    }
+  }
+
+  void remove(int slot) {
+    if (_prev[slot] != NONE) _next[_prev[slot]] = _next[slot]; else _head = _next[slot];
+    if (_next[slot] != NONE) _prev[_next[slot]] = _prev[slot]; else _tail = _prev[slot];
+  }
+
+  void update(int slot, uint32_t key) {
+    if (key == _key[slot]) return;
+    remove(slot);
+    insert(slot, key);
+  }
+
+  uint32_t keyOf(int slot) const { return _key[slot]; }
+
+  // newest first:  for (int s = first(); s >= 0; s = next(s)) { .. }
+  int first() const { return _head == NONE ? -1 : _head; }
+  int next(int slot) const { return _next[slot] == NONE ? -1 : _next[slot]; }
+};
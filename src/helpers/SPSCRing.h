@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief  Lock-free ring buffer, for exactly ONE producer (eg. an ISR or task) and ONE consumer (eg. main loop).
+ *         Items are filled/read in place: producer does claim() then commit(), consumer does peek() then release().
+ *         N must be a power of 2.
+ */
+template <typename T, int N>
+class SPSCRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCRing size must be a power of 2");
+
+  T _items[N];
+  volatile uint16_t _head;   // only written by producer
+  volatile uint16_t _tail;   // only written by consumer
+
+public:
+  SPSCRing() { _head = _tail = 0; }
+
+  int count() const { return (uint16_t)(_head - _tail); }
+  bool isEmpty() const { return _head == _tail; }
+  bool isFull() const { return count() >= N; }
+
+  // producer side
+  T* claim() { return isFull() ? NULL : &_items[_head & (N - 1)]; }   // NULL if full
+  void commit() { __sync_synchronize(); _head = _head + 1; }
+
+  // consumer side
+  T* peek() { return isEmpty() ? NULL : &_items[_tail & (N - 1)]; }
+  void release() { __sync_synchronize(); _tail = _tail + 1; }
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Mesh.h>
+#include <helpers/LinkQualityTable.h>
 
 #ifdef ESP32
   #include <FS.h>
@@ -15,6 +16,7 @@ class SimpleMeshTables : public mesh::MeshTables {
   uint32_t _acks[MAX_PACKET_ACKS];
   int _next_ack_idx;
   uint32_t _direct_dups, _flood_dups;
+  LinkQualityTable _links;
 
 public:
   SimpleMeshTables() { 
@@ -104,6 +106,12 @@ public:
     }
   }
 
+  void onLinkRecv(const uint8_t* hash, uint8_t hash_size, float snr) override { _links.onRecv(hash, hash_size, snr); }
+  void onLinkDelivery(const uint8_t* hash, uint8_t hash_size, bool delivered) override { _links.onDelivery(hash, hash_size, delivered); }
+  const mesh::LinkQuality* findLink(const uint8_t* hash, uint8_t hash_size) const override { return _links.find(hash, hash_size); }
+  int getNumLinks() const override { return _links.getCount(); }
+  const mesh::LinkQuality* getLinkByIdx(int i) const override { return _links.getByIdx(i); }
+
   uint32_t getNumDirectDups() const { return _direct_dups; }
   uint32_t getNumFloodDups() const { return _flood_dups; }
 
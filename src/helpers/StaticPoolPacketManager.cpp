@@ -17,7 +17,15 @@ int PacketQueue::countBefore(uint32_t now) const {
   return n;
 }
 
-mesh::Packet* PacketQueue::get(uint32_t now) {
+uint32_t PacketQueue::nextScheduled() const {
+  uint32_t t = 0xFFFFFFFF;
+  for (int j = 0; j < _num; j++) {
+    if (_schedule_table[j] < t) t = _schedule_table[j];
+  }
+  return t;
+}
+
+int PacketQueue::findNext(uint32_t now) const {
   uint8_t min_pri = 0xFF;
   int best_idx = -1;
   for (int j = 0; j < _num; j++) {
@@ -27,6 +35,23 @@ mesh::Packet* PacketQueue::get(uint32_t now) {
       best_idx = j;
     }
   }
+  return best_idx;
+}
+
+void PacketQueue::findClassHeads(uint32_t now, const mesh::OutboundScheduler* sched, int heads[]) const {
+  for (int c = 0; c < TX_NUM_CLASSES; c++) heads[c] = -1;
+
+  for (int j = 0; j < _num; j++) {
+    if (_schedule_table[j] > now) continue;   // scheduled for future... ignore for now
+    int c = sched->classify(_table[j]);
+    if (heads[c] < 0 || _pri_table[j] < _pri_table[heads[c]]) {  // by priority within each class
+      heads[c] = j;
+    }
+  }
+}
+
+mesh::Packet* PacketQueue::get(uint32_t now) {
+  int best_idx = findNext(now);
   if (best_idx < 0) return NULL;   // empty, or all items are still in the future
 
   mesh::Packet* top = _table[best_idx];
@@ -55,18 +80,34 @@ mesh::Packet* PacketQueue::removeByIdx(int i) {
   return item;
 }
 
-void PacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
-  if (_num == _size) {
-    // TODO: log "FATAL: queue is full!"
-    return;
+int PacketQueue::findLeastImportant() const {
+  int worst = -1;
+  for (int j = 0; j < _num; j++) {
+    if (worst < 0 || _pri_table[j] > _pri_table[worst] || (_pri_table[j] == _pri_table[worst] && _schedule_table[j] > _schedule_table[worst])) {
+      worst = j;
+    }
   }
+  return worst;
+}
+
+bool PacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  if (_num == _size) return false;   // caller must put packet back in pool
+
   _table[_num] = packet;
   _pri_table[_num] = priority;
   _schedule_table[_num] = scheduled_for;
   _num++;
+  return true;
+}
+
+static int dropClass(uint8_t pri) {
+  return pri == 0 ? 0 : (pri <= 2 ? 1 : (pri <= 4 ? 2 : 3));
 }
 
 StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): unused(pool_size), send_queue(pool_size), rx_queue(pool_size) {
+  resetStats();
+  _sched = NULL;
+
   // load up our unusued Packet pool
   for (int i = 0; i < pool_size; i++) {
     unused.add(new mesh::Packet(), 0, 0);
@@ -74,7 +115,17 @@ StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): unused(pool_siz
 }
 
 mesh::Packet* StaticPoolPacketManager::allocNew() {
-  return unused.removeByIdx(0);  // just get first one (returns NULL if empty)
+  return unused.removeByIdx(0);  // just get first one
+}
+
+mesh::Packet* StaticPoolPacketManager::reclaimOutbound(uint8_t priority) {
+  int i = send_queue.findLeastImportant();
+  if (i < 0 || send_queue.priorityAt(i) <= priority) return NULL;   // nothing less important to sacrifice
+
+  uint8_t pri = send_queue.priorityAt(i);
+  MESH_DEBUG_PRINTLN("StaticPoolPacketManager::reclaimOutbound(): pool empty, dropped outbound packet with priority %d", (uint32_t)pri);
+  n_tx_drops[dropClass(pri)]++;
+  return send_queue.removeByIdx(i);
 }
 
 void StaticPoolPacketManager::free(mesh::Packet* packet) {
@@ -82,12 +133,57 @@ void StaticPoolPacketManager::free(mesh::Packet* packet) {
 }
 
 void StaticPoolPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
-  send_queue.add(packet, priority, scheduled_for);
+  if (!send_queue.add(packet, priority, scheduled_for)) {
+    MESH_DEBUG_PRINTLN("StaticPoolPacketManager::queueOutbound(): queue is full!");
+    n_tx_drops[dropClass(priority)]++;
+    free(packet);
+  }
+}
+
+void StaticPoolPacketManager::setTxWeights(const uint8_t weights[]) {
+  if (weights[0] == 0) {
+    _sched = NULL;   // strict priority
+  } else {
+    _drr.setWeights(weights);
+    _sched = &_drr;
+  }
+}
+
+int StaticPoolPacketManager::findNextOutbound(uint32_t now, bool peek) const {
+  if (_sched == NULL) return send_queue.findNext(now);   // strict priority
+
+  int heads[TX_NUM_CLASSES], head_len[TX_NUM_CLASSES];
+  send_queue.findClassHeads(now, _sched, heads);
+  bool any = false;
+  for (int c = 0; c < TX_NUM_CLASSES; c++) {
+    if (heads[c] >= 0) {
+      head_len[c] = send_queue.itemAt(heads[c])->getRawLength();
+      any = true;
+    } else {
+      head_len[c] = 0;
+    }
+  }
+  if (!any) return -1;   // empty, or all items are still in the future
+
+  return heads[_sched->selectClass(head_len, peek)];
 }
 
 mesh::Packet* StaticPoolPacketManager::getNextOutbound(uint32_t now) {
-  //send_queue.sort();   // sort by scheduled_for/priority first
-  return send_queue.get(now);
+  int i = findNextOutbound(now, false);
+  if (i < 0) return NULL;
+
+  uint32_t delay = now - send_queue.scheduledAt(i);
+  int b = 0;
+  for (uint32_t limit = 32; b < TX_DELAY_BUCKETS-1 && delay >= limit; limit <<= 1) b++;
+  int c = _sched ? _sched->classify(send_queue.itemAt(i)) : mesh::OutboundScheduler::classifyPacket(send_queue.itemAt(i));
+  tx_delay_hist[c][b]++;
+
+  return send_queue.removeByIdx(i);
+}
+
+int StaticPoolPacketManager::getNextOutboundPriority(uint32_t now) const {
+  int i = findNextOutbound(now, true);
+  return i < 0 ? -1 : send_queue.priorityAt(i);
 }
 
 int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
@@ -106,7 +202,11 @@ mesh::Packet* StaticPoolPacketManager::removeOutboundByIdx(int i) {
 }
 
 void StaticPoolPacketManager::queueInbound(mesh::Packet* packet, uint32_t scheduled_for) {
-  rx_queue.add(packet, 0, scheduled_for);
+  if (!rx_queue.add(packet, 0, scheduled_for)) {
+    MESH_DEBUG_PRINTLN("StaticPoolPacketManager::queueInbound(): queue is full!");
+    n_rx_drops++;
+    free(packet);
+  }
 }
 mesh::Packet* StaticPoolPacketManager::getNextInbound(uint32_t now) {
   return rx_queue.get(now);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <Dispatcher.h>
+#include <helpers/DRRScheduler.h>
+
+#define QUEUE_DROP_CLASSES   4    // priority 0, 1..2, 3..4, 5+
 
 class PacketQueue {
   mesh::Packet** _table;
@@ -10,28 +13,56 @@ class PacketQueue {
 
 public:
   PacketQueue(int max_entries);
+  int findNext(uint32_t now) const;
+  void findClassHeads(uint32_t now, const mesh::OutboundScheduler* sched, int heads[]) const;   // next index per class, or -1
   mesh::Packet* get(uint32_t now);
-  void add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
+  bool add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);   // false if queue is full
+  int findLeastImportant() const;   // lowest priority, then scheduled furthest out, or -1 if empty
   int count() const { return _num; }
   int countBefore(uint32_t now) const;
+  uint32_t nextScheduled() const;   // or 0xFFFFFFFF if empty
   mesh::Packet* itemAt(int i) const { return _table[i]; }
+  uint8_t priorityAt(int i) const { return _pri_table[i]; }
+  uint32_t scheduledAt(int i) const { return _schedule_table[i]; }
   mesh::Packet* removeByIdx(int i);
 };
 
 class StaticPoolPacketManager : public mesh::PacketManager {
   PacketQueue unused, send_queue, rx_queue;
+  uint32_t n_tx_drops[QUEUE_DROP_CLASSES];
+  uint32_t n_rx_drops;
+  uint32_t tx_delay_hist[TX_NUM_CLASSES][TX_DELAY_BUCKETS];
+  mesh::OutboundScheduler* _sched;
+  DRRScheduler _drr;
+
+  int findNextOutbound(uint32_t now, bool peek) const;
 
 public:
   StaticPoolPacketManager(int pool_size);
 
   mesh::Packet* allocNew() override;
+  mesh::Packet* reclaimOutbound(uint8_t priority) override;
   void free(mesh::Packet* packet) override;
   void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
   mesh::Packet* getNextOutbound(uint32_t now) override;
+  int getNextOutboundPriority(uint32_t now) const override;
   int getOutboundCount(uint32_t now) const override;
   int getFreeCount() const override;
   mesh::Packet* getOutboundByIdx(int i) override;
   mesh::Packet* removeOutboundByIdx(int i) override;
   void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
   mesh::Packet* getNextInbound(uint32_t now) override;
+  void setScheduler(mesh::OutboundScheduler* sched) override { _sched = sched; }
+  void setTxWeights(const uint8_t weights[]);   // TX_NUM_CLASSES entries for fair scheduling, or all zero for strict priority
+  uint32_t getNextOutboundTime() const override { return send_queue.nextScheduled(); }
+  uint32_t getNextInboundTime() const override { return rx_queue.nextScheduled(); }
+
+  uint32_t getNumTxDrops(int pri_class) const { return n_tx_drops[pri_class]; }   // outbound packets evicted or rejected
+  uint32_t getNumRxDrops() const { return n_rx_drops; }
+  const uint32_t* getTxDelayHistogram(int tx_class) const { return tx_delay_hist[tx_class]; }   // time spent waiting, after being due
+  void resetStats() {
+    memset(n_tx_drops, 0, sizeof(n_tx_drops));
+    n_rx_drops = 0;
+    memset(tx_delay_hist, 0, sizeof(tx_delay_hist));
+  }
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "TxtCompressor.h"
+#include <string.h>
+
+#define DICT_CODES_LOW     0x1F   // codes 0x01..0x1F
+#define DICT_CODES_HIGH    0x7F   // codes 0x7F..0xFD
+#define CODE_VERBATIM_1    0xFE
+#define CODE_VERBATIM_RUN  0xFF
+
+// NOTE: must not change (without a new TXT_TYPE_*), as both ends must have the same dictionary!
+static const char* const dict[] = {
+  " the ", " and ", " you ", " for ", " that", " this", " with", " have", " are ", " not ", " is ",
+  " it ", " to ", " of ", " in ", " on ", " at ", " be ", " we ", " me ", " my ", " so ", " do ",
+  " no ", " if ", " up ", " can", " will", " just", " what", " get", " got", " all", " out",
+  " now", " was", " but", " how", " here", " there", "the", "ing", "ion", "ent", "and", "tha",
+  "her", "ere", "ter", "hat", "his", "ave", "ver", "ith", "for", "our", "ome", "ght", "ell", "est",
+  "ore", "ati", "ate", "ain", "ould", "ally", "ight", "ment", "tion", "th", "he", "in", "er", "an",
+  "re", "on", "at", "en", "nd", "ti", "es", "or", "te", "of", "ed", "is", "it", "al", "ar", "st",
+  "to", "nt", "ng", "se", "ha", "as", "ou", "io", "le", "ve", "co", "me", "de", "hi", "ri", "ro",
+  "ic", "ne", "ea", "ra", "ce", "li", "ch", "ll", "be", "ma", "si", "om", "ur", "ee", "oo", "ow",
+  "ay", "ly", "wh", "e ", "s ", "t ", "d ", "y ", "n ", "r ", "o ", ", ", ". ", "? ", "! ", " a",
+  " t", " s", " w", " i", " o", " h", " m", " b", " c", " f", " d", " l", " p", " n", " r", " g",
+  " I", "...", "lol", "ok"
+};
+
+#define NUM_DICT_ENTRIES  ((int)(sizeof(dict) / sizeof(dict[0])))   // must be 158 (max)
+
+static uint8_t idxToCode(int idx) {
+  return idx < DICT_CODES_LOW ? idx + 1 : (idx - DICT_CODES_LOW) + DICT_CODES_HIGH;
+}
+
+static int codeToIdx(uint8_t code) {
+  if (code >= 1 && code <= DICT_CODES_LOW) return code - 1;
+  if (code >= DICT_CODES_HIGH && code < CODE_VERBATIM_1) return (code - DICT_CODES_HIGH) + DICT_CODES_LOW;
+  return -1;  // not a dictionary code
+}
+
+static bool isLiteral(uint8_t c) {
+  return c >= 0x20 && c <= 0x7E;
+}
+
+int TxtCompressor::compress(uint8_t* dest, int dest_sz, const char* src, int src_len) {
+  const uint8_t* sp = (const uint8_t *) src;
+  int i = 0, n = 0;
+  while (i < src_len) {
+    // greedy: find longest dictionary match at this position
+    int best_idx = -1, best_len = 1;
+    for (int d = 0; d < NUM_DICT_ENTRIES; d++) {
+      const char* entry = dict[d];
+      if (entry[0] != sp[i]) continue;   // quick reject
+
+      int elen = strlen(entry);
+      if (elen > best_len && elen <= src_len - i && memcmp(entry, &sp[i], elen) == 0) {
+        best_idx = d; best_len = elen;
+      }
+    }
+
+    if (best_idx >= 0) {
+      if (n + 1 > dest_sz) return -1;
+      dest[n++] = idxToCode(best_idx);
+      i += best_len;
+    } else if (isLiteral(sp[i])) {
+      if (n + 1 > dest_sz) return -1;
+      dest[n++] = sp[i++];
+    } else {
+      int run = 1;  // collect run of non-ASCII bytes
+      while (run < 255 && i + run < src_len && !isLiteral(sp[i + run])) run++;
+
+      if (run == 1) {
+        if (n + 2 > dest_sz) return -1;
+        dest[n++] = CODE_VERBATIM_1;
+      } else {
+        if (n + 2 + run > dest_sz) return -1;
+        dest[n++] = CODE_VERBATIM_RUN;
+        dest[n++] = run;
+      }
+      memcpy(&dest[n], &sp[i], run);
+      n += run; i += run;
+    }
+  }
+  return n;
+}
+
+int TxtCompressor::decompress(char* dest, int dest_sz, const uint8_t* src, int src_len) {
+  int i = 0, n = 0;
+  while (i < src_len && src[i] != 0) {   // zero byte is end of text
+    uint8_t c = src[i++];
+    if (isLiteral(c)) {
+      if (n + 1 >= dest_sz) break;
+      dest[n++] = c;
+    } else if (c == CODE_VERBATIM_1 || c == CODE_VERBATIM_RUN) {
+      int run = 1;
+      if (c == CODE_VERBATIM_RUN) {
+        if (i >= src_len) break;  // malformed
+        run = src[i++];
+      }
+      if (i + run > src_len || n + run >= dest_sz) break;   // malformed, or truncate
+      memcpy(&dest[n], &src[i], run);
+      n += run; i += run;
+    } else {
+      int idx = codeToIdx(c);
+      if (idx < 0 || idx >= NUM_DICT_ENTRIES) break;   // malformed
+
+      int elen = strlen(dict[idx]);
+      if (n + elen >= dest_sz) break;   // truncate
+      memcpy(&dest[n], dict[idx], elen);
+      n += elen;
+    }
+  }
+  dest[n] = 0;  // null terminator
+  return n;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \brief  Static-dictionary compressor, tuned for short chat messages (for TXT_TYPE_COMPRESSED payloads)
+ *
+ *   Encoded stream (never contains a zero byte, so a null terminator can still follow it):
+ *     0x20..0x7E       literal ASCII char
+ *     0x01..0x1F,
+ *     0x7F..0xFD       index into static dictionary of common fragments
+ *     0xFE <b>         single verbatim byte
+ *     0xFF <n> <n*b>   run of n verbatim bytes (eg. UTF-8 sequences)
+ */
+class TxtCompressor {
+public:
+  /**
+   * \returns  length of encoded bytes written to dest, or -1 if won't fit in dest_sz
+   */
+  static int compress(uint8_t* dest, int dest_sz, const char* src, int src_len);
+
+  /**
+   * \returns  length of decoded text in dest (is always null terminated, truncated to fit dest_sz)
+   */
+  static int decompress(char* dest, int dest_sz, const uint8_t* src, int src_len);
+};
@@ -1,14 +1,24 @@
 #include "ESPNOWRadio.h"
+#include <helpers/SPSCRing.h>
 #include <esp_now.h>
 #include <WiFi.h>
 #include <esp_wifi.h>
 
+#ifndef ESPNOW_RX_RING_SIZE
+  #define ESPNOW_RX_RING_SIZE   8
+#endif
+
+struct ESPNowFrame {
+  uint8_t len;
+  uint8_t data[ESP_NOW_MAX_DATA_LEN];
+};
+
 static uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
 static esp_now_peer_info_t peerInfo;
 static volatile bool is_send_complete = false;
 static esp_err_t last_send_result;
-static uint8_t rx_buf[256];
-static uint8_t last_rx_len = 0;
+static SPSCRing<ESPNowFrame, ESPNOW_RX_RING_SIZE> rx_ring;   // producer is WiFi task, consumer is main loop
+static volatile uint32_t n_rx_backlog = 0, n_rx_dropped = 0;   // only written by WiFi task
 
 // callback when data is sent
 static void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
@@ -18,8 +28,15 @@ static void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
 
 static void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
   ESPNOW_DEBUG_PRINTLN("Recv: len = %d", len);
-  memcpy(rx_buf, data, len);
-  last_rx_len = len;
+  ESPNowFrame* frame = rx_ring.claim();
+  if (frame == NULL || len <= 0 || len > (int)sizeof(frame->data)) {
+    n_rx_dropped = n_rx_dropped + 1;   // main loop too far behind (or invalid)
+    return;
+  }
+  memcpy(frame->data, data, len);
+  frame->len = len;
+  if (!rx_ring.isEmpty()) n_rx_backlog = n_rx_backlog + 1;
+  rx_ring.commit();
 }
 
 void ESPNOWRadio::init() {
@@ -99,15 +116,27 @@ float ESPNOWRadio::getLastRSSI() const { return 0; }
 float ESPNOWRadio::getLastSNR() const { return 0; }
 
 int ESPNOWRadio::recvRaw(uint8_t* bytes, int sz) {
-  int len = last_rx_len;
-  if (last_rx_len > 0) {
-    memcpy(bytes, rx_buf, last_rx_len);
-    last_rx_len = 0;
+  int len = 0;
+  ESPNowFrame* frame = rx_ring.peek();
+  if (frame) {
+    len = frame->len;
+    if (len > sz) { len = sz; }
+    memcpy(bytes, frame->data, len);
+    rx_ring.release();
     n_recv++;
   }
   return len;
 }
 
+uint32_t ESPNOWRadio::getRecvBacklog() const { return n_rx_backlog - _backlog_base; }
+uint32_t ESPNOWRadio::getRecvDropped() const { return n_rx_dropped - _dropped_base; }
+
+void ESPNOWRadio::resetStats() {
+  n_recv = n_sent = 0;
+  _backlog_base = n_rx_backlog;   // counters are owned by WiFi task, so don't write to them here
+  _dropped_base = n_rx_dropped;
+}
+
 uint32_t ESPNOWRadio::getEstAirtimeFor(int len_bytes) {
   return 4;  // Fast AF
 }
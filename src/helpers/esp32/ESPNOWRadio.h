@@ -5,9 +5,10 @@
 class ESPNOWRadio : public mesh::Radio {
 protected:
   uint32_t n_recv, n_sent;
+  uint32_t _backlog_base, _dropped_base;
 
 public:
-  ESPNOWRadio() { n_recv = n_sent = 0; }
+  ESPNOWRadio() { n_recv = n_sent = 0; _backlog_base = _dropped_base = 0; }
 
   void init();
   int recvRaw(uint8_t* bytes, int sz) override;
@@ -19,7 +20,9 @@ public:
 
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsSent() const { return n_sent; }
-  void resetStats() { n_recv = n_sent = 0; }
+  uint32_t getRecvBacklog() const override;
+  uint32_t getRecvDropped() const override;
+  void resetStats();
 
   virtual float getLastRSSI() const override;
   virtual float getLastSNR() const override;
@@ -9,6 +9,8 @@ class CustomLR1110 : public LR1110 {
   public:
     CustomLR1110(Module *mod) : LR1110(mod) { }
 
+    uint8_t getSpreadingFactor() const { return spreadingFactor; }
+
     RadioLibTime_t getTimeOnAir(size_t len) override {
   // calculate number of symbols
   float N_symbol = 0;
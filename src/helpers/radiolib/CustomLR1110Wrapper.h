@@ -20,7 +20,22 @@ public:
     _radio->setPreambleLength(16); // overcomes weird issues with small and big pkts
   }
 
-  float getLastRSSI() const override { return ((CustomLR1110 *)_radio)->getRSSI(); }
-  float getLastSNR() const override { return ((CustomLR1110 *)_radio)->getSNR(); }
+  float getPacketRSSI() override { return ((CustomLR1110 *)_radio)->getRSSI(); }
+  float getPacketSNR() override { return ((CustomLR1110 *)_radio)->getSNR(); }
+
+  void applyParams(float freq, float bw, uint8_t sf, uint8_t cr) override {
+    auto radio = (CustomLR1110 *)_radio;
+    radio->setFrequency(freq);
+    radio->setSpreadingFactor(sf);
+    radio->setBandwidth(bw);
+    radio->setCodingRate(cr);
+  }
+  void applyTxPower(int8_t dbm) override { ((CustomLR1110 *)_radio)->setOutputPower(dbm); }
+
   int16_t setRxBoostedGainMode(bool en) { return ((CustomLR1110 *)_radio)->setRxBoostedGainMode(en); };
+
+  float packetScore(float snr, int packet_len) override {
+    int sf = ((CustomLR1110 *)_radio)->getSpreadingFactor();
+    return packetScoreInt(snr, sf, packet_len);
+  }
 };
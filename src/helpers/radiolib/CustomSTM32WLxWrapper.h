@@ -13,8 +13,17 @@ public:
   float getCurrentRSSI() override {
     return ((CustomSTM32WLx *)_radio)->getRSSI(false);
   }
-  float getLastRSSI() const override { return ((CustomSTM32WLx *)_radio)->getRSSI(); }
-  float getLastSNR() const override { return ((CustomSTM32WLx *)_radio)->getSNR(); }
+  float getPacketRSSI() override { return ((CustomSTM32WLx *)_radio)->getRSSI(); }
+  float getPacketSNR() override { return ((CustomSTM32WLx *)_radio)->getSNR(); }
+
+  void applyParams(float freq, float bw, uint8_t sf, uint8_t cr) override {
+    auto radio = (CustomSTM32WLx *)_radio;
+    radio->setFrequency(freq);
+    radio->setSpreadingFactor(sf);
+    radio->setBandwidth(bw);
+    radio->setCodingRate(cr);
+  }
+  void applyTxPower(int8_t dbm) override { ((CustomSTM32WLx *)_radio)->setOutputPower(dbm); }
 
   float packetScore(float snr, int packet_len) override {
     int sf = ((CustomSTM32WLx *)_radio)->spreadingFactor;
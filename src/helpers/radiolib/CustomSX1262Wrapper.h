@@ -12,8 +12,17 @@ public:
   float getCurrentRSSI() override {
     return ((CustomSX1262 *)_radio)->getRSSI(false);
   }
-  float getLastRSSI() const override { return ((CustomSX1262 *)_radio)->getRSSI(); }
-  float getLastSNR() const override { return ((CustomSX1262 *)_radio)->getSNR(); }
+  float getPacketRSSI() override { return ((CustomSX1262 *)_radio)->getRSSI(); }
+  float getPacketSNR() override { return ((CustomSX1262 *)_radio)->getSNR(); }
+
+  void applyParams(float freq, float bw, uint8_t sf, uint8_t cr) override {
+    auto radio = (CustomSX1262 *)_radio;
+    radio->setFrequency(freq);
+    radio->setSpreadingFactor(sf);
+    radio->setBandwidth(bw);
+    radio->setCodingRate(cr);
+  }
+  void applyTxPower(int8_t dbm) override { ((CustomSX1262 *)_radio)->setOutputPower(dbm); }
 
   float packetScore(float snr, int packet_len) override {
     int sf = ((CustomSX1262 *)_radio)->spreadingFactor;
@@ -1,6 +1,7 @@
 
 #define RADIOLIB_STATIC_ONLY 1
 #include "RadioLibWrappers.h"
+#include <helpers/LoRaAirtime.h>
 
 #define STATE_IDLE       0
 #define STATE_RX         1
@@ -13,6 +14,26 @@
 
 static volatile uint8_t state = STATE_IDLE;
 
+#ifdef RADIO_RX_TASK
+  #ifndef RADIO_RX_TASK_STACK
+    #ifdef ESP32
+      #define RADIO_RX_TASK_STACK   3072   // bytes
+    #else
+      #define RADIO_RX_TASK_STACK    512   // words
+    #endif
+  #endif
+
+static TaskHandle_t rx_task = NULL;
+static SemaphoreHandle_t radio_mutex = NULL;   // radio SPI access is shared between rx_task and main loop
+
+  // NOTE: mutex is created in begin(), there's no rx_task to contend with before then
+  #define RADIO_LOCK()     do { if (radio_mutex) xSemaphoreTake(radio_mutex, portMAX_DELAY); } while (0)
+  #define RADIO_UNLOCK()   do { if (radio_mutex) xSemaphoreGive(radio_mutex); } while (0)
+#else
+  #define RADIO_LOCK()
+  #define RADIO_UNLOCK()
+#endif
+
 // this function is called when a complete packet
 // is transmitted by the module
 static 
@@ -22,16 +43,44 @@ static
 void setFlag(void) {
   // we sent a packet, set the flag
   state |= STATE_INT_READY;
+#ifdef RADIO_RX_TASK
+  if (rx_task) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(rx_task, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+#endif
 }
 
+#ifdef RADIO_RX_TASK
+void RadioLibWrapper::rxTask(void* arg) {
+  RadioLibWrapper* self = (RadioLibWrapper *) arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // wait for radio IRQ
+    RADIO_LOCK();
+    self->readRecvFrame();
+    RADIO_UNLOCK();
+  }
+}
+#endif
+
 void RadioLibWrapper::begin() {
   _radio->setPacketReceivedAction(setFlag);  // this is also SentComplete interrupt
   state = STATE_IDLE;
 
+#ifdef RADIO_RX_TASK
+  if (rx_task == NULL) {
+    radio_mutex = xSemaphoreCreateMutex();
+    xTaskCreate(rxTask, "radio_rx", RADIO_RX_TASK_STACK, this, 2, &rx_task);   // higher priority than main loop
+  }
+#endif
+
   if (_board->getStartupReason() == BD_STARTUP_RX_PACKET) {  // received a LoRa packet (while in deep sleep)
-    setFlag(); // LoRa packet is already received
+    state |= STATE_INT_READY; // LoRa packet is already received (will be read by main loop)
   }
 
+  resetAirtimeTable();
+
   _noise_floor = 0;
   _threshold = 0;
 
@@ -41,8 +90,10 @@ void RadioLibWrapper::begin() {
 }
 
 void RadioLibWrapper::idle() {
+  RADIO_LOCK();
   _radio->standby();
   state = STATE_IDLE;   // need another startReceive()
+  RADIO_UNLOCK();
 }
 
 void RadioLibWrapper::triggerNoiseFloorCalibrate(int threshold) {
@@ -55,15 +106,39 @@ void RadioLibWrapper::triggerNoiseFloorCalibrate(int threshold) {
 
 void RadioLibWrapper::resetAGC() {
   // make sure we're not mid-receive of packet!
-  if ((state & STATE_INT_READY) != 0 || isReceivingPacket()) return;
+  RADIO_LOCK();
+  if ((state & STATE_INT_READY) == 0 && !isReceivingPacket()) {
+    // NOTE: according to higher powers, just issuing RadioLib's startReceive() will reset the AGC.
+    //      revisit this if a better impl is discovered.
+    state = STATE_IDLE;   // trigger a startReceive()
+  }
+  RADIO_UNLOCK();
+}
+
+void RadioLibWrapper::setParams(float freq, float bw, uint8_t sf, uint8_t cr) {
+  RADIO_LOCK();
+  applyParams(freq, bw, sf, cr);
+  if (state == STATE_RX) state = STATE_IDLE;   // restart Rx with new params
+  RADIO_UNLOCK();
+  resetAirtimeTable();
+}
+
+void RadioLibWrapper::setTxPower(int8_t dbm) {
+  RADIO_LOCK();
+  applyTxPower(dbm);
+  RADIO_UNLOCK();
+}
 
-  // NOTE: according to higher powers, just issuing RadioLib's startReceive() will reset the AGC.
-  //      revisit this if a better impl is discovered.
-  state = STATE_IDLE;   // trigger a startReceive()
+bool RadioLibWrapper::hasPendingWork() {
+  if (!_rx_ring.isEmpty()) return true;   // frames waiting to be read
+  if (state & STATE_INT_READY) return true;   // packet received or sent
+  if (state == STATE_IDLE) return true;   // need to startReceive()
+  return state == STATE_RX && _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES;   // still sampling noise floor
 }
 
 void RadioLibWrapper::loop() {
   if (state == STATE_RX && _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES) {
+    RADIO_LOCK();
     if (!isReceivingPacket()) {
       int rssi = getCurrentRSSI();
       if (rssi < _noise_floor + SAMPLING_THRESHOLD) {  // only consider samples below current floor + sampling THRESHOLD
@@ -71,6 +146,7 @@ void RadioLibWrapper::loop() {
         _floor_sample_sum += rssi;
       }
     }
+    RADIO_UNLOCK();
   } else if (_num_floor_samples >= NUM_NOISE_FLOOR_SAMPLES && _floor_sample_sum != 0) {
     _noise_floor = _floor_sample_sum / NUM_NOISE_FLOOR_SAMPLES;
     if (_noise_floor < -120) {
@@ -95,44 +171,81 @@ bool RadioLibWrapper::isInRecvMode() const {
   return (state & ~STATE_INT_READY) == STATE_RX;
 }
 
-int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
-  int len = 0;
-  if (state & STATE_INT_READY) {
-    len = _radio->getPacketLength();
+// NOTE: called with radio locked (if RADIO_RX_TASK)
+void RadioLibWrapper::readRecvFrame() {
+  if ((state & STATE_INT_READY) == 0 || (state & ~STATE_INT_READY) == STATE_TX_WAIT) return;   // nothing received (or is send complete IRQ)
+
+  RadioRxFrame* frame = _rx_ring.claim();
+  if (frame == NULL) {
+    n_rx_dropped++;   // ring full, main loop is too far behind
+  } else {
+    int len = _radio->getPacketLength();
     if (len > 0) {
-      if (len > sz) { len = sz; }
-      int err = _radio->readData(bytes, len);
+      if (len > MAX_TRANS_UNIT) { len = MAX_TRANS_UNIT; }
+      int err = _radio->readData(frame->data, len);
       if (err != RADIOLIB_ERR_NONE) {
         MESH_DEBUG_PRINTLN("RadioLibWrapper: error: readData(%d)", err);
-        len = 0;
       } else {
-      //  Serial.print("  readData() -> "); Serial.println(len);
-        n_recv++;
+        frame->len = len;
+        frame->rssi = getPacketRSSI();
+        frame->snr = getPacketSNR();
+        if (!_rx_ring.isEmpty()) n_rx_backlog++;   // previous frame not read yet, would have been lost
+        _rx_ring.commit();
       }
     }
-    state = STATE_IDLE;   // need another startReceive()
   }
+  state = STATE_IDLE;
+  startRecv();   // straight back into Rx mode
+}
 
+int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
+  RADIO_LOCK();
+  readRecvFrame();   // if no RADIO_RX_TASK, or it hasn't got to it yet
   if (state != STATE_RX) {
-    int err = _radio->startReceive();
-    if (err == RADIOLIB_ERR_NONE) {
-      state = STATE_RX;
-    } else {
-      MESH_DEBUG_PRINTLN("RadioLibWrapper: error: startReceive(%d)", err);
-    }
+    startRecv();
+  }
+  RADIO_UNLOCK();
+
+  int len = 0;
+  RadioRxFrame* frame = _rx_ring.peek();
+  if (frame) {
+    len = frame->len;
+    if (len > sz) { len = sz; }
+    memcpy(bytes, frame->data, len);
+    _last_rssi = frame->rssi;
+    _last_snr = frame->snr;
+    _rx_ring.release();
+  //  Serial.print("  readData() -> "); Serial.println(len);
+    n_recv++;
   }
   return len;
 }
 
+// slowest params that prefs can hold (temp radio params can go lower, those entries just saturate)
+static_assert(LoRaAirtime::millis(MAX_TRANS_UNIT, 12, 62.5f, 8) <= 0xFFFF, "_airtime[] entries need more than 16 bits");
+
+void RadioLibWrapper::resetAirtimeTable() {
+  for (int len = 0; len <= MAX_TRANS_UNIT; len++) {
+    uint32_t t = _radio->getTimeOnAir(len) / 1000;
+    _airtime[len] = t > 0xFFFF ? 0xFFFF : t;
+  }
+}
+
 uint32_t RadioLibWrapper::getEstAirtimeFor(int len_bytes) {
-  return _radio->getTimeOnAir(len_bytes) / 1000;
+  if (len_bytes < 0 || len_bytes > MAX_TRANS_UNIT) return _radio->getTimeOnAir(len_bytes) / 1000;
+
+  return _airtime[len_bytes];
 }
 
 bool RadioLibWrapper::startSendRaw(const uint8_t* bytes, int len) {
   _board->onBeforeTransmit();
+  RADIO_LOCK();
   int err = _radio->startTransmit((uint8_t *) bytes, len);
   if (err == RADIOLIB_ERR_NONE) {
     state = STATE_TX_WAIT;
+  }
+  RADIO_UNLOCK();
+  if (err == RADIOLIB_ERR_NONE) {
     return true;
   }
   MESH_DEBUG_PRINTLN("RadioLibWrapper: error: startTransmit(%d)", err);
@@ -150,26 +263,40 @@ bool RadioLibWrapper::isSendComplete() {
 }
 
 void RadioLibWrapper::onSendFinished() {
+  RADIO_LOCK();
   _radio->finishTransmit();
-  _board->onAfterTransmit();
   state = STATE_IDLE;
+  RADIO_UNLOCK();
+  _board->onAfterTransmit();
 }
 
 bool RadioLibWrapper::isChannelActive() {
-  return _threshold == 0 
-          ? false    // interference check is disabled
-          : getCurrentRSSI() > _noise_floor + _threshold;
+  if (_threshold == 0) return false;    // interference check is disabled
+
+  RADIO_LOCK();
+  bool active = getCurrentRSSI() > _noise_floor + _threshold;
+  RADIO_UNLOCK();
+  return active;
+}
+
+bool RadioLibWrapper::isReceiving() {
+  RADIO_LOCK();
+  bool receiving = isReceivingPacket();
+  RADIO_UNLOCK();
+  if (receiving) return true;
+
+  return isChannelActive();
 }
 
 float RadioLibWrapper::getLastRSSI() const {
-  return _radio->getRSSI();
+  return _last_rssi;
 }
 float RadioLibWrapper::getLastSNR() const {
-  return _radio->getSNR();
+  return _last_snr;
 }
 
 // Approximate SNR threshold per SF for successful reception (based on Semtech datasheets)
-static float snr_threshold[] = {
+static const float snr_threshold[] = {
     -7.5,  // SF7 needs at least -7.5 dB SNR
     -10,   // SF8 needs at least -10 dB SNR
     -12.5, // SF9 needs at least -12.5 dB SNR
@@ -177,14 +304,32 @@ static float snr_threshold[] = {
     -17.5,// SF11 needs at least -17.5 dB SNR
     -20   // SF12 needs at least -20 dB SNR
 };
-  
+
+// success rate by SNR margin above threshold (0.5 dB steps), x 255. Default is linear over first 10 dB
+static const uint8_t default_score_calib[SCORE_CALIB_SIZE] = {
+    0,  13,  26,  38,  51,  64,  77,  89, 102, 115, 128, 140, 153, 166, 179, 191,
+  204, 217, 230, 242, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+};
+
+void RadioLibWrapper::setScoreCalibration(const uint8_t* table) {
+  _score_calib = table ? table : default_score_calib;
+}
+
 float RadioLibWrapper::packetScoreInt(float snr, int sf, int packet_len) {
-  if (sf < 7) return 0.0f;
-  
-  if (snr < snr_threshold[sf - 7]) return 0.0f;    // Below threshold, no chance of success
+  if (sf < 7 || sf > 12) return 0.0f;
+
+  float margin = (snr - snr_threshold[sf - 7]) * 2.0f;   // in 0.5 dB steps
+  if (margin < 0.0f) return 0.0f;    // Below threshold, no chance of success
 
-  auto success_rate_based_on_snr = (snr - snr_threshold[sf - 7]) / 10.0;
-  auto collision_penalty = 1 - (packet_len / 256.0);   // Assuming max packet of 256 bytes
+  float success_rate_based_on_snr;
+  int i = (int) margin;
+  if (i >= SCORE_CALIB_SIZE - 1) {
+    success_rate_based_on_snr = _score_calib[SCORE_CALIB_SIZE - 1] / 255.0f;
+  } else {   // interpolate between steps
+    float frac = margin - i;
+    success_rate_based_on_snr = (_score_calib[i] + (_score_calib[i + 1] - _score_calib[i]) * frac) / 255.0f;
+  }
+  float collision_penalty = 1.0f - (packet_len / 256.0f);   // Assuming max packet of 256 bytes
 
-  return max(0.0, min(1.0, success_rate_based_on_snr * collision_penalty));
+  return max(0.0f, min(1.0f, success_rate_based_on_snr * collision_penalty));
 }
@@ -2,38 +2,77 @@
 
 #include <Mesh.h>
 #include <RadioLib.h>
+#include <helpers/SPSCRing.h>
+
+// RADIO_RX_TASK: (ESP32/NRF52 only) read received frames from radio in a separate task, woken by the radio IRQ,
+//    so reception is restarted straight away even if main loop is busy (eg. writing to flash)
+//    NOTE: radio params must only be changed via setParams()/setTxPower(), which hold the radio lock
+#ifndef RADIO_RX_RING_SIZE
+  #ifdef RADIO_RX_TASK
+    #define RADIO_RX_RING_SIZE   4
+  #else
+    #define RADIO_RX_RING_SIZE   1    // read by main loop, so no need to buffer more
+  #endif
+#endif
+
+#define SCORE_CALIB_SIZE   32    // SNR margin (above the SF's demod threshold) -> score curve, in 0.5 dB steps
+
+struct RadioRxFrame {
+  float rssi, snr;
+  uint8_t len;
+  uint8_t data[MAX_TRANS_UNIT];
+};
 
 class RadioLibWrapper : public mesh::Radio {
 protected:
   PhysicalLayer* _radio;
   mesh::MainBoard* _board;
   uint32_t n_recv, n_sent;
+  uint32_t n_rx_backlog, n_rx_dropped;
   int16_t _noise_floor, _threshold;
   uint16_t _num_floor_samples;
   int32_t _floor_sample_sum;
+  SPSCRing<RadioRxFrame, RADIO_RX_RING_SIZE> _rx_ring;
+  float _last_rssi, _last_snr;
+  uint16_t _airtime[MAX_TRANS_UNIT+1];   // millis, by packet length
+  const uint8_t* _score_calib;
 
   void idle();
   void startRecv();
+  void readRecvFrame();
   float packetScoreInt(float snr, int sf, int packet_len);
   virtual bool isReceivingPacket() =0;
+  virtual float getPacketRSSI() { return _radio->getRSSI(); }   // of packet just received
+  virtual float getPacketSNR() { return _radio->getSNR(); }
+  virtual void applyParams(float freq, float bw, uint8_t sf, uint8_t cr) =0;   // called with radio locked
+  virtual void applyTxPower(int8_t dbm) =0;
+
+#ifdef RADIO_RX_TASK
+  static void rxTask(void* arg);
+#endif
 
 public:
-  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) { n_recv = n_sent = 0; }
+  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) {
+    n_recv = n_sent = 0;
+    n_rx_backlog = n_rx_dropped = 0;
+    _last_rssi = _last_snr = 0;
+    memset(_airtime, 0, sizeof(_airtime));   // filled in begin(), once radio is initialised
+    setScoreCalibration(NULL);
+  }
 
   void begin() override;
   int recvRaw(uint8_t* bytes, int sz) override;
   uint32_t getEstAirtimeFor(int len_bytes) override;
+  void resetAirtimeTable();   // recalc for current SF/BW/CR
+  void setParams(float freq, float bw, uint8_t sf, uint8_t cr);   // safe to call at any time, resets airtime table
+  void setTxPower(int8_t dbm);
   bool startSendRaw(const uint8_t* bytes, int len) override;
   bool isSendComplete() override;
   void onSendFinished() override;
   bool isInRecvMode() const override;
   bool isChannelActive();
 
-  bool isReceiving() override { 
-    if (isReceivingPacket()) return true;
-
-    return isChannelActive();
-  }
+  bool isReceiving() override;
 
   virtual float getCurrentRSSI() =0;
 
@@ -42,15 +81,24 @@ public:
   void resetAGC() override;
 
   void loop() override;
+  bool hasPendingWork() override;
 
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsSent() const { return n_sent; }
-  void resetStats() { n_recv = n_sent = 0; }
+  uint32_t getRecvBacklog() const override { return n_rx_backlog; }   // ie. would have been lost, without the RX ring
+  uint32_t getRecvDropped() const override { return n_rx_dropped; }   // because RX ring was full
+  void resetStats() { n_recv = n_sent = 0; n_rx_backlog = n_rx_dropped = 0; }
 
   virtual float getLastRSSI() const override;
   virtual float getLastSNR() const override;
 
   float packetScore(float snr, int packet_len) override { return packetScoreInt(snr, 10, packet_len); }  // assume sf=10
+
+  /**
+   * \brief  replace the default SNR margin -> score curve (linear over 10 dB), eg. with one fitted from simulator or field data.
+   * \param  table  SCORE_CALIB_SIZE entries, score x 255, by SNR margin in 0.5 dB steps. Must remain valid. (NULL = default)
+   */
+  void setScoreCalibration(const uint8_t* table);
 };
 
 /**
@@ -0,0 +1,174 @@
+// Host-side check and benchmark for helpers/ContactIndex.h (no Arduino deps). Build + run with:  make -C tools/host_tests
+
+#include <helpers/ContactIndex.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define PUB_KEY_SIZE  32
+
+struct Key {
+  uint8_t pub_key[PUB_KEY_SIZE];
+};
+
+static std::mt19937 rng(12345);
+
+static void randomKey(Key& k) {
+  for (int i = 0; i < PUB_KEY_SIZE; i++) k.pub_key[i] = rng() & 0xFF;
+}
+
+static int failures = 0;
+
+#define CHECK(cond, ...)  if (!(cond)) { printf("FAIL: " __VA_ARGS__); printf("\n"); failures++; return; }
+
+// ---------------- randomised alloc/free, against a linear-scan model ----------------
+
+template <int N>
+static void checkAgainstModel(const ContactIndex<N>& idx, const std::vector<int>& model_hash) {
+  int used = 0;
+  for (int s = 0; s < N; s++) {
+    CHECK(idx.isUsed(s) == (model_hash[s] >= 0), "slot %d used=%d, model says %d", s, (int)idx.isUsed(s), model_hash[s]);
+    if (model_hash[s] >= 0) used++;
+  }
+  CHECK(idx.count() == used, "count %d, model has %d", idx.count(), used);
+  CHECK(idx.isFull() == (used == N), "isFull() wrong at count %d", used);
+
+  std::vector<bool> seen(N, false);
+  for (int i = 0; i < idx.count(); i++) {
+    int s = idx.slotAt(i);
+    CHECK(s >= 0 && s < N && model_hash[s] >= 0 && !seen[s], "slotAt(%d) = %d, not a unique used slot", i, s);
+    seen[s] = true;
+  }
+
+  for (int h = 0; h < 256; h++) {
+    std::vector<bool> in_bucket(N, false);
+    int n = 0;
+    for (int s = idx.first(h); s >= 0; s = idx.next(s)) {
+      CHECK(s < N && model_hash[s] == h && !in_bucket[s], "bucket %d has bad slot %d", h, s);
+      in_bucket[s] = true;
+      CHECK(++n <= N, "bucket %d chain loops", h);
+    }
+    int expected = 0;
+    for (int s = 0; s < N; s++) if (model_hash[s] == h) expected++;
+    CHECK(n == expected, "bucket %d has %d slots, model has %d", h, n, expected);
+  }
+}
+
+template <int N>
+static void randomOps(int num_ops, int check_every) {
+  static ContactIndex<N> idx;
+  idx.clear();
+  std::vector<int> model_hash(N, -1);   // -1 = free, else hash of contact in slot
+  int num_hashes = N > 64 ? 256 : 4;   // small tables: few hashes, so buckets get long
+
+  for (int op = 0; op < num_ops && failures == 0; op++) {
+    int used = idx.count();
+    bool add = used == 0 || (used < N && (rng() % 100) < 55);
+    if (add) {
+      uint8_t h = rng() % num_hashes;
+      int s = idx.alloc(h);
+      CHECK(s >= 0 && s < N && model_hash[s] < 0, "alloc() returned %d, which isn't a free slot", s);
+      model_hash[s] = h;
+    } else {
+      int s;
+      do { s = rng() % N; } while (model_hash[s] < 0);
+      idx.free(s, model_hash[s]);
+      model_hash[s] = -1;
+    }
+    if (op % check_every == 0) checkAgainstModel(idx, model_hash);
+
+    if (idx.isFull()) {
+      CHECK(idx.alloc(0) == -1, "alloc() when full should fail");
+    }
+  }
+  if (failures == 0) checkAgainstModel(idx, model_hash);
+  printf("random alloc/free, N=%d, %d ops: %s\n", N, num_ops, failures ? "FAILED" : "ok");
+}
+
+// ---------------- benchmark: linear scan vs indexed ----------------
+
+static double nsPer(std::chrono::steady_clock::time_point t0, int n) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+static volatile int sink;
+
+template <int N>
+static void bench() {
+  static Key keys[N], linear[N];
+  static ContactIndex<N> idx;
+  static Key by_slot[N];
+
+  idx.clear();
+  for (int i = 0; i < N; i++) {
+    randomKey(keys[i]);
+    linear[i] = keys[i];
+    int s = idx.alloc(keys[i].pub_key[0]);
+    by_slot[s] = keys[i];
+  }
+
+  const int LOOKUPS = 200000;
+  std::vector<int> which(LOOKUPS);
+  for (int i = 0; i < LOOKUPS; i++) which[i] = rng() % N;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    const uint8_t* k = keys[which[i]].pub_key;
+    int found = -1;
+    for (int j = 0; j < N; j++) {
+      if (memcmp(linear[j].pub_key, k, PUB_KEY_SIZE) == 0) { found = j; break; }
+    }
+    sink = found;
+  }
+  double lin_lookup = nsPer(t0, LOOKUPS);
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < LOOKUPS; i++) {
+    const uint8_t* k = keys[which[i]].pub_key;
+    int found = -1;
+    for (int s = idx.first(k[0]); s >= 0; s = idx.next(s)) {
+      if (memcmp(by_slot[s].pub_key, k, PUB_KEY_SIZE) == 0) { found = s; break; }
+    }
+    sink = found;
+  }
+  double idx_lookup = nsPer(t0, LOOKUPS);
+
+  // remove then re-add one contact, so table size stays the same
+  const int REMOVES = N >= 1000 ? 20000 : 100000;
+  t0 = std::chrono::steady_clock::now();
+  int num = N;
+  for (int i = 0; i < REMOVES; i++) {
+    int j = which[i] % num;
+    Key k = linear[j];
+    memmove(&linear[j], &linear[j + 1], (num - j - 1) * sizeof(Key));   // as the old removeContact()
+    linear[num - 1] = k;
+  }
+  double lin_remove = nsPer(t0, REMOVES);
+
+  t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < REMOVES; i++) {
+    int s = idx.slotAt(which[i] % idx.count());
+    uint8_t h = by_slot[s].pub_key[0];
+    idx.free(s, h);
+    sink = idx.alloc(h);
+  }
+  double idx_remove = nsPer(t0, REMOVES);
+
+  printf("%8d %10.0f / %5.0f ns %12.0f / %5.0f ns\n", N, lin_lookup, idx_lookup, lin_remove, idx_remove);
+}
+
+int main() {
+  randomOps<8>(200000, 1);
+  randomOps<300>(200000, 97);
+  randomOps<5000>(1000000, 9973);
+
+  printf("\ncontacts   lookup linear / indexed    remove shift / indexed\n");
+  bench<100>();
+  bench<1000>();
+  bench<5000>();
+
+  return failures ? 1 : 0;
+}
@@ -43,14 +43,11 @@ uint32_t radio_get_rng_seed() {
 }
 
 void radio_set_params(float freq, float bw, uint8_t sf, uint8_t cr) {
-  radio.setFrequency(freq);
-  radio.setSpreadingFactor(sf);
-  radio.setBandwidth(bw);
-  radio.setCodingRate(cr);
+  radio_driver.setParams(freq, bw, sf, cr);
 }
 
 void radio_set_tx_power(uint8_t dbm) {
-  radio.setOutputPower(dbm);
+  radio_driver.setTxPower(dbm);
 }
 
 mesh::LocalIdentity radio_new_identity() {